@@ -0,0 +1,202 @@
+#!/bin/bash
+
+# led benchmarks
+# usage: ./bench.sh [filter regex on bench names]
+# env:
+#   LED_BENCH_MB    size of each generated corpus in MB (default 4)
+#   LED_BENCH_RUNS  number of runs per bench, the best one is kept (default 3)
+#   LED_BENCH_OUT   results file, tab separated values (default bench/results.tsv)
+
+SCRIPT_DIR=$(cd $(dirname $0); pwd)
+BENCH_DIR=$SCRIPT_DIR/bench
+LED=$SCRIPT_DIR/led
+
+FILTER=${1:-.}
+MB=${LED_BENCH_MB:-4}
+RUNS=${LED_BENCH_RUNS:-3}
+OUT=${LED_BENCH_OUT:-$BENCH_DIR/results.tsv}
+
+[ -x $LED ] || { echo "led binary not found, run make first" >&2; exit 1; }
+
+mkdir -p $BENCH_DIR/corpus $BENCH_DIR/work
+
+#-----------------------------------------------
+# corpus generation
+# deterministic: a Park-Miller generator seeded per corpus,
+# the files are generated again only when the size changes
+#-----------------------------------------------
+
+corpus_gen() {
+    local name=$1
+    local file=$BENCH_DIR/corpus/$name.txt
+    local size=$((MB * 1024 * 1024))
+    [ -f $file ] && [ $(stat -c %s $file) -ge $size ] && return
+    echo "generate corpus $name ($MB MB)"
+    awk -v kind=$name -v size=$size '
+    function rnd(n) { seed = (seed * 16807) % 2147483647; return seed % n }
+    function word(n,   s, i) { s = ""; for (i = 0; i < n; i++) s = s substr(alpha, rnd(26) + 1, 1); return s }
+    function pick(list,   a, n) { n = split(list, a, " "); return a[rnd(n) + 1] }
+    BEGIN {
+        seed = 12345
+        alpha = "abcdefghijklmnopqrstuvwxyz"
+        b64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+        u8 = "été naïve œuvre Ünïcödé straße ΑΒΓΔ λόγος привет мир 日本語 テキスト 한국어 中文字符 𝄞𝄢 😀 🚀 émoji ǅ ß ǈ"
+        total = 0
+        line = 0
+        while (total < size) {
+            line++
+            if (kind == "logs") {
+                s = sprintf("2024-%02d-%02d %02d:%02d:%02d.%03d %-5s [%s] user=%s id=%d took=%dms %s %s",
+                    rnd(12) + 1, rnd(28) + 1, rnd(24), rnd(60), rnd(60), rnd(1000),
+                    pick("INFO INFO INFO DEBUG WARN ERROR"), pick("main worker-1 worker-2 http db"),
+                    word(rnd(6) + 3), rnd(1000000), rnd(5000), word(rnd(8) + 2), pick("ok retry failed timeout"))
+            }
+            else if (kind == "utf8") {
+                s = ""
+                n = rnd(12) + 4
+                for (i = 0; i < n; i++) s = s (i ? " " : "") (rnd(3) ? pick(u8) : word(rnd(7) + 1))
+            }
+            else if (kind == "long") {
+                s = ""
+                n = rnd(32768) + 32768
+                while (length(s) < n) s = s word(rnd(9) + 1) pick(" , ; \t") " "
+            }
+            else if (kind == "csv") {
+                s = sprintf("%d,%s,%s,%d.%02d,\"%s %s\",%s,%d", line, word(rnd(8) + 3), pick("fr de us jp br"),
+                    rnd(10000), rnd(100), word(rnd(5) + 2), word(rnd(5) + 2), pick("true false"), rnd(100000))
+            }
+            else if (kind == "paths") {
+                s = pick("/usr /home/user /var/lib /opt /tmp /srv/data")
+                n = rnd(6) + 1
+                for (i = 0; i < n; i++) s = s "/" pick("src lib Build My\\ Docs Data_Set test v1.2 photos") (rnd(4) ? "" : "-" word(3))
+                s = s "/" word(rnd(8) + 2) (rnd(2) ? "_" : " ") toupper(word(rnd(5) + 1)) pick(".c .h .txt .tar.gz .JPG")
+            }
+            else if (kind == "b64") {
+                s = ""
+                n = (rnd(30) + 4) * 4
+                for (i = 0; i < n; i++) s = s substr(b64, rnd(64) + 1, 1)
+            }
+            print s
+            total += length(s) + 1
+        }
+    }' > $file
+}
+
+for c in logs utf8 long csv paths b64; do
+    corpus_gen $c
+done
+
+#-----------------------------------------------
+# bench runner
+#-----------------------------------------------
+
+now_us() {
+    local t=$EPOCHREALTIME
+    echo $((${t/./} + 0))
+}
+
+echo -e "bench\tcorpus\targs\tbytes\tlines\tseconds\tmb_s\tns_line\tstatus" > $OUT
+printf "%-28s %-6s %10s %12s %10s  %s\n" BENCH CORPUS SECONDS MB/S NS/LINE ARGS
+
+# bench <name> <corpus> <mode> <led args...>
+# mode: stdin (input piped, output to /dev/null), file (input file as argument),
+#       copy (input file copied before each run), inplace (copy modified with -F)
+bench() {
+    local name=$1 corpus=$2 mode=$3
+    shift 3
+    [[ $name =~ $FILTER ]] || return 0
+    local file=$BENCH_DIR/corpus/$corpus.txt
+    local work=$BENCH_DIR/work/$corpus.txt
+    local bytes=$(stat -c %s $file)
+    local lines=$(wc -l < $file)
+    local best=0 status=0 run t0 t1
+    for ((run = 0; run < RUNS; run++)); do
+        rm -rf $BENCH_DIR/work/*
+        mkdir -p $BENCH_DIR/work/out
+        [ $mode = copy -o $mode = inplace ] && cp $file $work
+        t0=$(now_us)
+        case $mode in
+            stdin) $LED "$@" < $file > /dev/null 2>&1 ;;
+            file) (cd $BENCH_DIR/work && $LED "$@" -f $file < /dev/null > /dev/null 2>&1) ;;
+            copy) (cd $BENCH_DIR/work && $LED "$@" -f $work < /dev/null > /dev/null 2>&1) ;;
+            inplace) (cd $BENCH_DIR/work && $LED "$@" -F -f $work < /dev/null > /dev/null 2>&1) ;;
+        esac
+        status=$?
+        t1=$(now_us)
+        ((best == 0 || t1 - t0 < best)) && best=$((t1 - t0))
+    done
+    [ $status -le 1 ] && status=ok || status="error:$status"
+    awk -v n="$name" -v c=$corpus -v a="$*" -v b=$bytes -v l=$lines -v us=$best -v st=$status -v out=$OUT 'BEGIN {
+        s = us / 1000000
+        if (s <= 0) s = 0.000001
+        printf "%s\t%s\t%s\t%d\t%d\t%.6f\t%.2f\t%.1f\t%s\n", n, c, a, b, l, s, b / 1048576 / s, us * 1000 / l, st >> out
+        printf "%-28s %-6s %10.4f %12.2f %10.1f  %s%s\n", n, c, s, b / 1048576 / s, us * 1000 / l, a, (st == "ok" ? "" : "  (" st ")")
+    }'
+}
+
+#-----------------------------------------------
+# functions: every entry of the function table (read from the help)
+# with the arguments and corpus fitting the function
+#-----------------------------------------------
+
+# fn_args <function>: <corpus> <mode> <led args...>
+fn_args() {
+    case $1 in
+        s) echo "logs stdin s/user=(\\w+)/login=\$1/" ;;
+        i|a) echo "logs stdin $1//---" ;;
+        j) echo "logs stdin INFO WARN $1/ -p" ;;
+        tr) echo "logs stdin tr//abc/xyz" ;;
+        cl|cu|cf|cc|cs|rv) echo "utf8 stdin $1/" ;;
+        sp) echo "csv stdin sp//," ;;
+        spc|spm) echo "csv stdin $1/" ;;
+        tm|tml|tmr|sps) echo "long stdin $1/" ;;
+        fld) echo "csv stdin fld//2/," ;;
+        fls|flm) echo "logs stdin $1//3" ;;
+        flc) echo "csv stdin flc//2" ;;
+        cut) echo "csv stdin cut//1,3,5-6/," ;;
+        b64d) echo "b64 stdin b64d/" ;;
+        hash) echo "logs stdin hash//sha256" ;;
+        urle|urld|she|shu|cse|csu|jse|jsu|rp|dn|bn|fnl|fnu|fnc|fns) echo "paths stdin $1/" ;;
+        gen) echo "logs stdin gen//x/3" ;;
+        rn|rnu) echo "logs stdin $1//5/10" ;;
+        *) echo "logs stdin $1/" ;;
+    esac
+}
+
+for fn in $($LED -h 2>&1 | awk -F'|' '$2 ~ /^ *[0-9]+ *$/ { gsub(/ /, "", $4); print $4 }'); do
+    bench fn_$fn $(fn_args $fn)
+done
+
+#-----------------------------------------------
+# selector modes
+#-----------------------------------------------
+
+bench sel_none logs stdin
+bench sel_regex_literal logs stdin ERROR
+bench sel_regex logs stdin 'user=\w+ id=\d+ took=\d{4}ms'
+bench sel_regex_invert logs stdin ERROR -n
+bench sel_line logs stdin 1000
+bench sel_count logs stdin ERROR 3
+bench sel_start_stop logs stdin ERROR WARN
+bench sel_regex_fn logs stdin ERROR cu/
+bench sel_regex_fn_selected logs stdin ERROR cu/ -s
+bench sel_pack logs stdin ERROR WARN cu/ -p
+bench sel_match_zone logs stdin 'user=\w+' 'cu//user=\w+' -m
+
+#-----------------------------------------------
+# output modes
+#-----------------------------------------------
+
+bench out_stdout logs stdin cu/
+bench out_stdout_jobs logs stdin cu/ -j
+bench out_files logs file cu/
+bench out_write logs file cu/ -Wout.txt
+bench out_append logs file cu/ -Aout.txt
+bench out_ext logs copy cu/ -Eout
+bench out_dir logs file cu/ -Dout
+bench out_inplace logs inplace cu/
+bench out_inplace_same logs inplace ZZZZ cu/
+bench out_exec_batch paths stdin -Xbtrue
+
+rm -rf $BENCH_DIR/work
+echo -e "\nresults: $OUT"
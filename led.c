@@ -28,22 +28,16 @@ int main(int argc, char* argv[]) {
 
     if (led.opt.help)
         led_help();
+    else if (led.opt.jobs > 1 && led_pool_isready())
+        led_pool_run();
+    else if (led.opt.jobs > 1 && !led.opt.exec)
+        led_pool_run_chunks();
     else
-        while (led_file_next()) {
-            bool isline = false;
-            do {
-                isline = led_process_read();
-                if (led_process_selector()) {
-                    led_process_functions();
-                    if (led.opt.exec)
-                        led_process_exec();
-                    else
-                        led_process_write();
-                }
-            } while(isline);
-        }
+        while (led_file_next())
+            led_process_lines();
     if (led.opt.report)
         led_report();
+    int rc = led.report.exec_fail_count ? LED_ERR_EXEC : led.report.file_invalid_count ? LED_ERR_FILE : LED_SUCCESS;
     led_free();
-    return 0;
+    return rc;
 }
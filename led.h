@@ -26,10 +26,18 @@
 #include <stdio.h>
 #include <libgen.h>
 #include <stdbool.h>
+#include <setjmp.h>
+#include <time.h>
 
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
 
+// the inline functions have their external definitions in led_core.c
+// (LED_INLINE defined as extern inline), used when a call is not inlined
+#ifndef LED_INLINE
+#define LED_INLINE inline
+#endif
+
 //-----------------------------------------------
 // LED error management
 //-----------------------------------------------
@@ -39,6 +47,7 @@
 #define LED_ERR_FILE 3
 #define LED_ERR_MAXLINE 4
 #define LED_ERR_INTERNAL 5
+#define LED_ERR_EXEC 6
 
 #define LED_MSG_MAX 0x1000
 
@@ -46,6 +55,31 @@ void led_assert(bool cond, int code, const char* message, ...);
 void led_assert_pcre(int rc);
 void led_debug(const char* message, ...);
 
+//-----------------------------------------------
+// LED trace management
+// the per line traces are compiled only in the debug flavour (LED_TRACE defined)
+// and enabled at runtime by category and level (-T), a release build generates
+// no code for them but still checks the arguments
+//-----------------------------------------------
+#define LED_TRACE_IO 0x01
+#define LED_TRACE_SEL 0x02
+#define LED_TRACE_FUNC 0x04
+#define LED_TRACE_REGEX 0x08
+#define LED_TRACE_ALL 0x0F
+
+#define LED_TRACE_STEP 1
+#define LED_TRACE_DETAIL 2
+
+void led_trace_print(int cat, const char* message, ...);
+
+#ifdef LED_TRACE
+#define led_trace(CAT, LEVEL, ...) do { \
+    if ((led.opt.trace & (CAT)) && led.opt.trace_level >= (LEVEL)) led_trace_print(CAT, __VA_ARGS__); \
+} while (0)
+#else
+#define led_trace(CAT, LEVEL, ...) do { if (0) led_trace_print(CAT, __VA_ARGS__); } while (0)
+#endif
+
 //------------------------------------------------------------------------------
 // LED UTF8 support
 // thanks to clear explanations from
@@ -56,33 +90,60 @@ typedef uint32_t u8c_t;
 
 extern const size_t led_u8c_size_table[];
 
-inline size_t led_u8c_size(char* str) {
+LED_INLINE size_t led_u8c_size(char* str) {
     return led_u8c_size_table[(((uint8_t *)(str))[0] & 0xFF) >> 4];
 }
 
-inline bool led_u8c_iscont(char c) {
+LED_INLINE bool led_u8c_iscont(char c) {
     return (c & 0xC0) == 0x80;
 }
 
-inline bool led_u8c_isalnum(u8c_t c) {
+// Unicode tables (generated in led_case.c): simple case mappings by runs of
+// codes with the same delta (stride 2 for alternating upper/lower pairs)
+// and letter or digit ranges, ASCII is left out
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+    int32_t delta;
+    uint32_t stride;
+} led_case_run_t;
+
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} led_case_range_t;
+
+extern const led_case_run_t led_case_lower[];
+extern const size_t led_case_lower_count;
+extern const led_case_run_t led_case_upper[];
+extern const size_t led_case_upper_count;
+extern const led_case_range_t led_case_alnum[];
+extern const size_t led_case_alnum_count;
+
+bool led_u8c_isalnum_mb(u8c_t c);
+u8c_t led_u8c_tolower_mb(u8c_t c);
+u8c_t led_u8c_toupper_mb(u8c_t c);
+
+LED_INLINE bool led_u8c_isalnum(u8c_t c) {
+    if (c >= 0x80) return led_u8c_isalnum_mb(c);
     return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
 }
 
-inline bool led_u8c_isdigit(u8c_t c) {
+LED_INLINE bool led_u8c_isdigit(u8c_t c) {
     return (c >= '0' && c <= '9');
 }
 
-inline bool led_u8c_isspace(u8c_t c) {
+LED_INLINE bool led_u8c_isspace(u8c_t c) {
     return (c == ' ' || c == '\t' || c == '\r' || c == '\n');
 }
 
-inline u8c_t led_u8c_tolower(u8c_t c) {
-    if (c >= 'A' && c <= 'Z') c = tolower((char)c);
-    return c;
+LED_INLINE u8c_t led_u8c_tolower(u8c_t c) {
+    if (c >= 0x80) return led_u8c_tolower_mb(c);
+    return c >= 'A' && c <= 'Z' ? c | 0x20 : c;
 }
-inline u8c_t led_u8c_toupper(u8c_t c) {
-    if (c >= 'a' && c <= 'z') c = toupper((char)c);
-    return c;
+LED_INLINE u8c_t led_u8c_toupper(u8c_t c) {
+    if (c >= 0x80) return led_u8c_toupper_mb(c);
+    return c >= 'a' && c <= 'z' ? c & ~0x20 : c;
 }
 
 bool led_u8c_isvalid(u8c_t c);
@@ -90,21 +151,72 @@ bool led_u8c_isvalid(u8c_t c);
 u8c_t led_u8c_encode(uint32_t code);
 uint32_t led_u8c_decode(u8c_t c);
 
-size_t led_u8c_from_str(char* str, u8c_t* u8chr);
+LED_INLINE size_t led_u8c_from_str(char* str, u8c_t* u8chr) {
+    // ASCII fast path, one byte per char
+    if ((uint8_t)str[0] < 0x80) {
+        *u8chr = (uint8_t)str[0];
+        return 1;
+    }
+    size_t l = led_u8c_size(str);
+    u8c_t c = 0;
+    for (size_t i = 0; i < l && str[i]; i++)
+        c = (c << 8) | ((uint8_t*)str)[i];
+    *u8chr = c;
+    return l;
+}
+
 size_t led_u8c_from_rstr(char* str, size_t len, u8c_t* u8chr);
 size_t led_u8c_to_str(char* str, u8c_t u8chr);
 
+// buffer scans, vectorized on x86 (SSE2/SSSE3/AVX2 selected at runtime):
+// the length of the ASCII prefix and the length of the valid UTF-8 prefix
+size_t led_u8s_ascii_buf(const char* str, size_t len);
+size_t led_u8s_valid_buf(const char* str, size_t len);
+
+
+//------------------------------------------------------------------------------
+// Led memory arena.
+// Blocks are allocated by chunks growing geometrically and are all
+// released together at the end of the run.
+//------------------------------------------------------------------------------
+
+#define LED_ARENA_CHUNK_MIN 0x100000
+
+typedef struct led_arena_chunk_s {
+    struct led_arena_chunk_s* next;
+    size_t size;
+    size_t used;
+    char data[];
+} led_arena_chunk_t;
+
+typedef struct {
+    led_arena_chunk_t* chunk;
+    size_t total;
+    size_t max;
+} led_arena_t;
+
+void* led_arena_alloc(led_arena_t* parena, size_t size);
+void led_arena_free(led_arena_t* parena);
 
 //------------------------------------------------------------------------------
 // Led poor & simple string management without any memory allocation.
 // Led strings only wraps buffers declared statically or in the stack
 // to offer various management functions easyer.
+// A string linked to a growable buffer (pbuf) is extended from its arena
+// instead of being truncated when full.
 //------------------------------------------------------------------------------
 
+typedef struct {
+    char* str;
+    size_t size;
+    led_arena_t* arena;
+} led_u8s_buf_t;
+
 typedef struct {
     char* str;
     size_t len;
     size_t size;
+    led_u8s_buf_t* pbuf;
 } led_u8s_t;
 
 #define led_u8s_init_buf(VAR,BUF) led_u8s_init(VAR,BUF,sizeof(BUF))
@@ -134,94 +246,103 @@ typedef struct {
     size_t i = START; \
     for (u8c_t c = led_u8s_char_at(VAR, i); i < STOP; c = led_u8s_char_next(VAR, &i))
 
-inline size_t led_u8s_len(led_u8s_t* lstr) {
+LED_INLINE size_t led_u8s_len(led_u8s_t* lstr) {
     return lstr->len;
 }
 
-inline char* led_u8s_str(led_u8s_t* lstr) {
+LED_INLINE char* led_u8s_str(led_u8s_t* lstr) {
     return lstr->str;
 }
 
-inline size_t led_u8s_size(led_u8s_t* lstr) {
+LED_INLINE size_t led_u8s_size(led_u8s_t* lstr) {
     return lstr->size;
 }
 
-inline bool led_u8s_isinit(led_u8s_t* lstr) {
+LED_INLINE bool led_u8s_isinit(led_u8s_t* lstr) {
     return lstr->str != NULL;
 }
 
-inline bool led_u8s_isempty(led_u8s_t* lstr) {
+LED_INLINE bool led_u8s_isempty(led_u8s_t* lstr) {
     return led_u8s_isinit(lstr) && lstr->len == 0;
 }
 
-inline bool led_u8s_iscontent(led_u8s_t* lstr) {
+LED_INLINE bool led_u8s_iscontent(led_u8s_t* lstr) {
     return led_u8s_isinit(lstr) && lstr->len > 0;
 }
 
-inline bool led_u8s_isfull(led_u8s_t* lstr) {
+LED_INLINE bool led_u8s_isfull(led_u8s_t* lstr) {
     return led_u8s_isinit(lstr) && lstr->len + 1 == lstr->size;
 }
 
-inline led_u8s_t* led_u8s_reset(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_reset(led_u8s_t* lstr) {
     memset(lstr, 0, sizeof(*lstr));
     return lstr;
 }
 
 led_u8s_t* led_u8s_init(led_u8s_t* lstr, char* buf, size_t size);
+led_u8s_t* led_u8s_init_pbuf(led_u8s_t* lstr, led_u8s_buf_t* pbuf);
+void led_u8s_grow(led_u8s_t* lstr, size_t size);
+
+// ensure room for len more chars and return the len that can be appended
+LED_INLINE size_t led_u8s_room(led_u8s_t* lstr, size_t len) {
+    if (lstr->len + len < lstr->size) return len;
+    if (lstr->pbuf != NULL) {
+        led_u8s_grow(lstr, lstr->len + len + 1);
+        return len;
+    }
+    return lstr->size > lstr->len ? lstr->size - lstr->len - 1 : 0;
+}
 
-inline led_u8s_t* led_u8s_empty(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_empty(led_u8s_t* lstr) {
     lstr->str[0] = '\0';
     lstr->len = 0;
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_clone(led_u8s_t* lstr, led_u8s_t* lstr_src) {
+LED_INLINE led_u8s_t* led_u8s_clone(led_u8s_t* lstr, led_u8s_t* lstr_src) {
     lstr->str = lstr_src->str;
     lstr->len = lstr_src->len;
     lstr->size = lstr_src->size;
+    lstr->pbuf = NULL;
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_cpy(led_u8s_t* lstr, led_u8s_t* lstr_src) {
-    for(lstr->len = 0; lstr->len < lstr_src->len && lstr->len + 1 < lstr->size; lstr->len++)
-        lstr->str[lstr->len] = lstr_src->str[lstr->len];
+LED_INLINE led_u8s_t* led_u8s_app_buf(led_u8s_t* lstr, const char* buf, size_t len) {
+    len = led_u8s_room(lstr, len);
+    memcpy(lstr->str + lstr->len, buf, len);
+    lstr->len += len;
     lstr->str[lstr->len] = '\0';
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_cpy_chars(led_u8s_t* lstr, const char* str) {
-    for(lstr->len=0; str[lstr->len] && lstr->len+1 < lstr->size; lstr->len++)
-        lstr->str[lstr->len]=str[lstr->len];
-    lstr->str[lstr->len] = '\0';
-    return lstr;
+LED_INLINE led_u8s_t* led_u8s_cpy(led_u8s_t* lstr, led_u8s_t* lstr_src) {
+    lstr->len = 0;
+    return led_u8s_app_buf(lstr, lstr_src->str, lstr_src->len);
 }
 
-inline led_u8s_t* led_u8s_app(led_u8s_t* lstr, led_u8s_t* lstr_src) {
-    for(size_t i = 0; i<lstr_src->len && lstr->len+1 < lstr->size; i++, lstr->len++)
-        lstr->str[lstr->len] = lstr_src->str[i];
-    lstr->str[lstr->len] = '\0';
-    return lstr;
+LED_INLINE led_u8s_t* led_u8s_cpy_chars(led_u8s_t* lstr, const char* str) {
+    lstr->len = 0;
+    return led_u8s_app_buf(lstr, str, strlen(str));
 }
 
-inline led_u8s_t* led_u8s_app_str(led_u8s_t* lstr, const char* str) {
-    for(size_t i = 0; str[i] && lstr->len+1 < lstr->size; i++, lstr->len++)
-        lstr->str[lstr->len] = str[i];
-    lstr->str[lstr->len] = '\0';
-    return lstr;
+LED_INLINE led_u8s_t* led_u8s_app(led_u8s_t* lstr, led_u8s_t* lstr_src) {
+    return led_u8s_app_buf(lstr, lstr_src->str, lstr_src->len);
 }
 
-inline led_u8s_t* led_u8s_app_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop) {
-    for(size_t i = start; i < stop && lstr_src->str[i] && lstr->len+1 < lstr->size; i++, lstr->len++)
-        lstr->str[lstr->len] = lstr_src->str[i];
-    lstr->str[lstr->len] = '\0';
-    return lstr;
+LED_INLINE led_u8s_t* led_u8s_app_str(led_u8s_t* lstr, const char* str) {
+    return led_u8s_app_buf(lstr, str, strlen(str));
+}
+
+LED_INLINE led_u8s_t* led_u8s_app_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop) {
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    return led_u8s_app_buf(lstr, lstr_src->str + start, start < stop ? stop - start : 0);
 }
 
-inline led_u8s_t* led_u8s_app_char(led_u8s_t* lstr, u8c_t u8chr) {
+LED_INLINE led_u8s_t* led_u8s_app_char(led_u8s_t* lstr, u8c_t u8chr) {
     char buf[4];
     char* str = buf;
     size_t u8chr_len = led_u8c_to_str(str, u8chr);
-    if (lstr->len + u8chr_len < lstr->size) {
+    if (led_u8s_room(lstr, u8chr_len) == u8chr_len) {
         while (u8chr_len) {
             lstr->str[lstr->len++] = *(str++);
             u8chr_len--;
@@ -231,7 +352,24 @@ inline led_u8s_t* led_u8s_app_char(led_u8s_t* lstr, u8c_t u8chr) {
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_trunk_char(led_u8s_t* lstr, u8c_t u8chr) {
+// map the ASCII prefix of src into dst with a 128 entries table and return its length,
+// only the blocks of 16 entries set in the blocks mask differ from identity
+size_t led_u8s_map_ascii(char* dst, const char* src, size_t len, const uint8_t* map, uint8_t blocks);
+
+// append the zone converted to lower or upper case, ASCII runs are converted by vector blocks
+led_u8s_t* led_u8s_app_case_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, bool upper);
+
+// base64 variants: URL-safe alphabet and no padding chars
+#define LED_B64_URL 0x1
+#define LED_B64_NOPAD 0x2
+
+// append the zone encoded in base64 by vector blocks
+led_u8s_t* led_u8s_app_b64_encode_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, uint32_t flags);
+// append the zone decoded from base64 by vector blocks, both alphabets are accepted,
+// the padding and the chars out of the alphabet are skipped
+led_u8s_t* led_u8s_app_b64_decode_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop);
+
+LED_INLINE led_u8s_t* led_u8s_trunk_char(led_u8s_t* lstr, u8c_t u8chr) {
     u8c_t c = 0;
     size_t u8chr_len = led_u8c_from_rstr(lstr->str, lstr->len, &c);
     // led_debug("led_u8s_trunk_char - len=%lu", u8chr_len);
@@ -242,13 +380,13 @@ inline led_u8s_t* led_u8s_trunk_char(led_u8s_t* lstr, u8c_t u8chr) {
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_trunk_char_last(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_trunk_char_last(led_u8s_t* lstr) {
     while ( lstr->len > 0 && led_u8c_iscont(--(lstr->len)) );
     lstr->str[lstr->len] = '\0';
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_trunk(led_u8s_t* lstr, size_t len) {
+LED_INLINE led_u8s_t* led_u8s_trunk(led_u8s_t* lstr, size_t len) {
     if (len < lstr->len) {
         lstr->len = len;
         lstr->str[lstr->len] = '\0';
@@ -256,7 +394,7 @@ inline led_u8s_t* led_u8s_trunk(led_u8s_t* lstr, size_t len) {
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_trunk_end(led_u8s_t* lstr, size_t len) {
+LED_INLINE led_u8s_t* led_u8s_trunk_end(led_u8s_t* lstr, size_t len) {
     if (len < lstr->len) {
         lstr->len -= len;
         lstr->str[lstr->len] = '\0';
@@ -264,13 +402,13 @@ inline led_u8s_t* led_u8s_trunk_end(led_u8s_t* lstr, size_t len) {
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_rtrim(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_rtrim(led_u8s_t* lstr) {
     while(lstr->len > 0 && isspace(lstr->str[lstr->len-1])) lstr->len--;
     lstr->str[lstr->len] = '\0';
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_ltrim(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_ltrim(led_u8s_t* lstr) {
     size_t i=0,j=0;
     for(; i < lstr->len && isspace(lstr->str[i]); i++);
     for(; i < lstr->len; i++,j++)
@@ -280,11 +418,11 @@ inline led_u8s_t* led_u8s_ltrim(led_u8s_t* lstr) {
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_trim(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_trim(led_u8s_t* lstr) {
     return led_u8s_ltrim(led_u8s_rtrim(lstr));
 }
 
-inline led_u8s_t* led_u8s_cut_next(led_u8s_t* lstr, u8c_t u8chr, led_u8s_t* stok) {
+LED_INLINE led_u8s_t* led_u8s_cut_next(led_u8s_t* lstr, u8c_t u8chr, led_u8s_t* stok) {
     led_u8s_clone(stok, lstr);
     // led_debug("led_u8s_cut_next - lstr=%s tok=%s", lstr->str, stok->str);
     u8c_t c;
@@ -308,18 +446,18 @@ inline led_u8s_t* led_u8s_cut_next(led_u8s_t* lstr, u8c_t u8chr, led_u8s_t* stok
     return lstr;
 }
 
-inline u8c_t led_u8s_char_at(led_u8s_t* lstr, size_t idx) {
+LED_INLINE u8c_t led_u8s_char_at(led_u8s_t* lstr, size_t idx) {
     if (led_u8c_iscont(lstr->str[idx])) return '\0';
     u8c_t u8chr;
     led_u8c_from_str(lstr->str + idx, &u8chr);
     return u8chr;
 }
 
-inline u8c_t led_u8s_char_first(led_u8s_t* lstr) {
+LED_INLINE u8c_t led_u8s_char_first(led_u8s_t* lstr) {
     return led_u8s_char_at(lstr, 0);
 }
 
-inline u8c_t led_u8s_char_last(led_u8s_t* lstr) {
+LED_INLINE u8c_t led_u8s_char_last(led_u8s_t* lstr) {
     if (lstr->len == 0) return '\0';
     u8c_t u8chr = 0;
     size_t idx = lstr->len;
@@ -329,63 +467,63 @@ inline u8c_t led_u8s_char_last(led_u8s_t* lstr) {
     return u8chr;
 }
 
-inline u8c_t led_u8s_char_next(led_u8s_t* lstr, size_t* idx) {
+LED_INLINE u8c_t led_u8s_char_next(led_u8s_t* lstr, size_t* idx) {
     u8c_t u8chr;
     *idx  += led_u8c_from_str(lstr->str + *idx, &u8chr);
     return u8chr;
 }
 
-inline u8c_t led_u8s_char_prev(led_u8s_t* lstr, size_t* idx) {
+LED_INLINE u8c_t led_u8s_char_prev(led_u8s_t* lstr, size_t* idx) {
     u8c_t u8chr;
     *idx  -= led_u8c_from_rstr(lstr->str, *idx, &u8chr);
     return u8chr;
 }
 
-inline char* led_u8s_str_at(led_u8s_t* lstr, size_t idx) {
+LED_INLINE char* led_u8s_str_at(led_u8s_t* lstr, size_t idx) {
     if (led_u8c_iscont(lstr->str[idx])) return '\0';
     return lstr->str + idx;
 }
 
-inline bool led_u8s_equal(led_u8s_t* lstr1, led_u8s_t* lstr2) {
+LED_INLINE bool led_u8s_equal(led_u8s_t* lstr1, led_u8s_t* lstr2) {
     return lstr1->len == lstr2->len && strcmp(lstr1->str, lstr2->str) == 0;
 }
 
-inline bool led_u8s_equal_str(led_u8s_t* lstr, const char* str) {
+LED_INLINE bool led_u8s_equal_str(led_u8s_t* lstr, const char* str) {
     return strcmp(lstr->str, str) == 0;
 }
 
-inline bool led_u8s_equal_str_at(led_u8s_t* lstr, const char* str, size_t idx) {
+LED_INLINE bool led_u8s_equal_str_at(led_u8s_t* lstr, const char* str, size_t idx) {
     if ( idx > lstr->len ) return false;
     return strcmp(lstr->str + idx, str) == 0;
 }
 
-inline bool led_u8s_startswith(led_u8s_t* lstr1, led_u8s_t* lstr2) {
+LED_INLINE bool led_u8s_startswith(led_u8s_t* lstr1, led_u8s_t* lstr2) {
     size_t i = 0;
     for (; i < lstr1->len && lstr2->str[i] && lstr1->str[i] == lstr2->str[i]; i++);
     return lstr2->str[i] == '\0';
 }
 
-inline bool led_u8s_startswith_at(led_u8s_t* lstr1, led_u8s_t* lstr2, size_t start) {
+LED_INLINE bool led_u8s_startswith_at(led_u8s_t* lstr1, led_u8s_t* lstr2, size_t start) {
     if ( led_u8c_iscont(lstr1->str[start]) ) return false;
     size_t i = 0;
     for (; start < lstr1->len && i < lstr2->len && lstr1->str[start] == lstr2->str[i]; i++, start++);
     return lstr2->str[i] == '\0';
 }
 
-inline bool led_u8s_startswith_str(led_u8s_t* lstr, const char* str) {
+LED_INLINE bool led_u8s_startswith_str(led_u8s_t* lstr, const char* str) {
     size_t i = 0;
     for (; i < lstr->len && str[i] && lstr->str[i] == str[i]; i++);
     return str[i] == '\0';
 }
 
-inline bool led_u8s_startswith_str_at(led_u8s_t* lstr, const char* str, size_t start) {
+LED_INLINE bool led_u8s_startswith_str_at(led_u8s_t* lstr, const char* str, size_t start) {
     if ( led_u8c_iscont(lstr->str[start]) ) return false;
     size_t i = 0;
     for (; start < lstr->len && str[i] && lstr->str[start] == str[i]; i++, start++);
     return str[i] == '\0';
 }
 
-inline size_t led_u8s_find_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size_t stop) {
+LED_INLINE size_t led_u8s_find_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size_t stop) {
     while( start < stop ) {
         size_t pos = start;
         if (led_u8s_char_next(lstr, &start) == c) return pos;
@@ -393,11 +531,11 @@ inline size_t led_u8s_find_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size_
     return lstr->len;
 }
 
-inline size_t led_u8s_find_char(led_u8s_t* lstr, u8c_t c) {
+LED_INLINE size_t led_u8s_find_char(led_u8s_t* lstr, u8c_t c) {
     return led_u8s_find_char_zn(lstr, c, 0, lstr->len);
 }
 
-inline size_t led_u8s_rfind_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size_t stop) {
+LED_INLINE size_t led_u8s_rfind_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size_t stop) {
     u8c_t u8chr;
     while( stop > start )
         if ( !led_u8c_iscont(lstr->str[--stop]) ) {
@@ -407,15 +545,15 @@ inline size_t led_u8s_rfind_char_zn(led_u8s_t* lstr, u8c_t c, size_t start, size
     return lstr->len;
 }
 
-inline size_t led_u8s_rfind_char(led_u8s_t* lstr, u8c_t c) {
+LED_INLINE size_t led_u8s_rfind_char(led_u8s_t* lstr, u8c_t c) {
     return led_u8s_rfind_char_zn(lstr, c, 0, lstr->len);
 }
 
-inline bool led_u8s_ischar(led_u8s_t* lstr, u8c_t c) {
+LED_INLINE bool led_u8s_ischar(led_u8s_t* lstr, u8c_t c) {
     return led_u8s_find_char(lstr, c) < lstr->len;
 }
 
-inline size_t led_u8s_find(led_u8s_t* lstr1, led_u8s_t* lstr2) {
+LED_INLINE size_t led_u8s_find(led_u8s_t* lstr1, led_u8s_t* lstr2) {
     size_t i=0, j=0;
     for(; i < lstr1->len && lstr2->str[j]; i++)
         if (lstr1->str[i] == lstr2->str[j]) j++;
@@ -423,20 +561,107 @@ inline size_t led_u8s_find(led_u8s_t* lstr1, led_u8s_t* lstr2) {
     return lstr2->str[j] ? lstr1->len: i - j;
 }
 
-inline led_u8s_t* led_u8s_basename(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_basename(led_u8s_t* lstr) {
     lstr->str = basename(lstr->str);
     lstr->len = strlen(lstr->str);
     lstr->size = lstr->len + 1;
     return lstr;
 }
 
-inline led_u8s_t* led_u8s_dirname(led_u8s_t* lstr) {
+LED_INLINE led_u8s_t* led_u8s_dirname(led_u8s_t* lstr) {
     lstr->str = basename(lstr->str);
     lstr->len = strlen(lstr->str);
     lstr->size = lstr->len + 1;
     return lstr;
 }
 
+//-----------------------------------------------
+// LED char sets
+// A set is compiled once: a bitmap of the single byte chars, nibble tables
+// to find them by vector blocks and a sorted table of the multibyte chars.
+//-----------------------------------------------
+
+typedef struct {
+    uint8_t byte[32];
+    // bit h of nibble_low[l] is set when the ASCII char (h << 4 | l) is in the set
+    uint8_t nibble_low[16];
+    u8c_t* mb;
+    size_t mb_count;
+} led_charset_t;
+
+void led_charset_init(led_charset_t* pset, led_u8s_t* lchars);
+void led_charset_free(led_charset_t* pset);
+bool led_charset_has_mb(const led_charset_t* pset, u8c_t c);
+// position of the next char of the set in the zone (stop when not found)
+size_t led_charset_find(const led_charset_t* pset, led_u8s_t* lstr, size_t start, size_t stop);
+
+LED_INLINE bool led_charset_has(const led_charset_t* pset, u8c_t c) {
+    if (c < 0x100) return pset->byte[c >> 3] & (1 << (c & 7));
+    return led_charset_has_mb(pset, c);
+}
+
+// position of the next char out of the set in the zone (stop when not found)
+LED_INLINE size_t led_charset_skip(const led_charset_t* pset, led_u8s_t* lstr, size_t start, size_t stop) {
+    while (start < stop) {
+        size_t i = start;
+        if (!led_charset_has(pset, led_u8s_char_next(lstr, &i))) break;
+        start = i;
+    }
+    return start;
+}
+
+//-----------------------------------------------
+// LED escape schemes
+// A scheme gives the escape of each byte by a 256 entries table, the runs copied
+// as is are found by vector blocks with the nibble tables of the escaped ASCII bytes.
+//-----------------------------------------------
+
+// escape of a byte: none, %XX, a backslash before, \u00XX, \ooo
+// or any other value: a backslash and this char (\n)
+#define LED_ESC_NONE 0
+#define LED_ESC_PCT 1
+#define LED_ESC_BSL 2
+#define LED_ESC_U4 3
+#define LED_ESC_OCT 4
+
+typedef struct {
+    uint8_t byte[256];
+    // bit h of nibble_low[l] is set when the ASCII byte (h << 4 | l) is escaped
+    uint8_t nibble_low[16];
+    // the non ASCII bytes are escaped (all or none)
+    bool high;
+} led_esc_t;
+
+typedef enum {
+    LED_UNESC_URL,
+    LED_UNESC_SHELL,
+    LED_UNESC_C,
+    LED_UNESC_JSON,
+} led_unesc_t;
+
+// compile the nibble tables of a scheme from its byte table
+void led_esc_init(led_esc_t* pesc);
+// append the zone escaped with the scheme
+led_u8s_t* led_u8s_app_esc_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, const led_esc_t* pesc);
+// append the zone with the escape sequences of the scheme decoded, the invalid ones are kept
+led_u8s_t* led_u8s_app_unesc_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, led_unesc_t scheme);
+
+//-----------------------------------------------
+// LED hash functions
+// Digests of a whole buffer, written big endian (as printed):
+// crc32c on 4 bytes, xxh3 (64 bits) on 8 bytes, sha256 on 32 bytes.
+//-----------------------------------------------
+
+#define LED_HASH_CRC32C 0
+#define LED_HASH_XXH3 1
+#define LED_HASH_SHA256 2
+#define LED_HASH_SIZE_MAX 32
+// base64 output of a digest, with the LED_B64_* flags
+#define LED_HASH_ENC_B64 0x4
+
+// write the digest of the buffer with the algo and return its size
+size_t led_hash_digest(size_t algo, const char* src, size_t len, uint8_t* digest);
+
 //-----------------------------------------------
 // LED string pcre management
 //-----------------------------------------------
@@ -445,29 +670,45 @@ inline led_u8s_t* led_u8s_dirname(led_u8s_t* lstr) {
 #define LED_RGX_STR_MATCH 1
 #define LED_RGX_GROUP_MATCH 2
 
-extern pcre2_code* LED_REGEX_ALL_LINE;
-extern pcre2_code* LED_REGEX_BLANK_LINE;
-extern pcre2_code* LED_REGEX_INTEGER;
-extern pcre2_code* LED_REGEX_REGISTER;
-extern pcre2_code* LED_REGEX_FUNC;
-extern pcre2_code* LED_REGEX_FUNC2;
+// compiled regex shared in the registry, the id indexes the match data of each context
+typedef struct {
+    char* pattern;
+    pcre2_code* code;
+    size_t id;
+    size_t refs;
+} led_regex_t;
+
+extern led_regex_t* LED_REGEX_ALL_LINE;
+extern led_regex_t* LED_REGEX_BLANK_LINE;
+extern led_regex_t* LED_REGEX_INTEGER;
+extern led_regex_t* LED_REGEX_REGISTER;
+extern led_regex_t* LED_REGEX_FUNC;
+extern led_regex_t* LED_REGEX_FUNC2;
+
+// count of PCRE2 allocations, for the report
+extern size_t led_regex_alloc_count;
+
+// the JIT stack of a context starts small and grows up to the max
+#define LED_REGEX_JIT_STACK_MIN 0x8000
+#define LED_REGEX_JIT_STACK_MAX 0x400000
 
 void led_regex_init();
 void led_regex_free();
 
-pcre2_code* led_regex_compile(const char* pat);
-bool led_u8s_match(led_u8s_t* lstr, pcre2_code* regex);
-bool led_u8s_match_offset(led_u8s_t* lstr, pcre2_code* regex, size_t* pzone_start, size_t* pzone_stop);
+led_regex_t* led_regex_compile(const char* pat);
+void led_regex_release(led_regex_t* regex);
+pcre2_general_context* led_regex_gctx();
+pcre2_match_data* led_regex_match_data(led_regex_t* regex);
+int led_regex_match(led_regex_t* regex, const char* str, size_t len);
+bool led_u8s_match(led_u8s_t* lstr, led_regex_t* regex);
+bool led_u8s_match_pat(led_u8s_t* lstr, const char* pat);
+bool led_u8s_match_offset(led_u8s_t* lstr, led_regex_t* regex, size_t* pzone_start, size_t* pzone_stop);
 
-inline pcre2_code* led_u8s_regex_compile(led_u8s_t* pat) {
+LED_INLINE led_regex_t* led_u8s_regex_compile(led_u8s_t* pat) {
     return led_regex_compile(pat->str);
 }
 
-inline bool led_u8s_match_pat(led_u8s_t* lstr, const char* pat) {
-    return led_u8s_match(lstr, led_regex_compile(pat));
-}
-
-inline bool led_u8s_isblank(led_u8s_t* lstr) {
+LED_INLINE bool led_u8s_isblank(led_u8s_t* lstr) {
     return led_u8s_match(lstr, LED_REGEX_BLANK_LINE) > 0;
 }
 
@@ -475,12 +716,16 @@ inline bool led_u8s_isblank(led_u8s_t* lstr) {
 // LED constants
 //-----------------------------------------------
 
-#define LED_BUF_MAX 0x8000
+#define LED_LINE_INIT 0x100
+#define LED_LINE_MAX 0x10000000
 #define LED_FARG_MAX 3
 #define LED_SEL_MAX 2
 #define LED_FUNC_MAX 16
 #define LED_FNAME_MAX 0x1000
 #define LED_REG_MAX 10
+#define LED_GREP_LIT_MAX 0x40
+#define LED_TMPL_SEG_MAX 0x20
+#define LED_CUT_FIELD_MAX 0x100
 
 #define SEL_TYPE_NONE 0
 #define SEL_TYPE_REGEX 1
@@ -500,6 +745,10 @@ inline bool led_u8s_isblank(led_u8s_t* lstr) {
 #define LED_OUTPUT_FILE_NEWEXT 4
 #define LED_OUTPUT_FILE_DIR 5
 
+#define LED_EXEC_SPAWN 0
+#define LED_EXEC_SHELL 1
+#define LED_EXEC_BATCH 2
+
 #define ARGS_SEC_SELECT 0
 #define ARGS_SEC_FUNCT 1
 #define ARGS_SEC_FILES 2
@@ -508,83 +757,300 @@ inline bool led_u8s_isblank(led_u8s_t* lstr) {
 // LED line management
 //-----------------------------------------------
 
+// the line buffer is kept (and reused) when the line is reset.
 typedef struct {
     led_u8s_t lstr;
-    char buf[LED_BUF_MAX+1];
+    led_u8s_buf_t buf;
     size_t zone_start;
     size_t zone_stop;
     bool selected;
+    // the line only has ASCII chars (set at input), chars are then single bytes
+    bool ascii;
 } led_line_t;
 
-inline led_line_t* led_line_reset(led_line_t* pline) {
+LED_INLINE led_line_t* led_line_setup(led_line_t* pline, led_arena_t* parena) {
     memset(pline, 0, sizeof *pline);
+    pline->buf.arena = parena;
     return pline;
 }
 
-inline led_line_t* led_line_init(led_line_t* pline) {
+LED_INLINE led_line_t* led_line_reset(led_line_t* pline) {
+    led_u8s_reset(&pline->lstr);
+    pline->zone_start = 0;
+    pline->zone_stop = 0;
+    pline->selected = false;
+    pline->ascii = false;
+    return pline;
+}
+
+LED_INLINE led_line_t* led_line_init(led_line_t* pline) {
     led_line_reset(pline);
-    led_u8s_init_buf(&pline->lstr, pline->buf);
+    led_u8s_init_pbuf(&pline->lstr, &pline->buf);
     return pline;
 }
 
-inline led_line_t* led_line_cpy(led_line_t* pline, led_line_t* pline_src) {
-    pline->buf[0] = '\0';
+LED_INLINE led_line_t* led_line_cpy(led_line_t* pline, led_line_t* pline_src) {
     if (led_u8s_isinit(&pline_src->lstr)) {
-        led_u8s_init_buf(&pline->lstr, pline->buf);
+        led_u8s_init_pbuf(&pline->lstr, &pline->buf);
         led_u8s_cpy(&pline->lstr, &pline_src->lstr);
     }
     else
         led_u8s_reset(&pline->lstr);
     pline->selected = pline_src->selected;
+    pline->ascii = pline_src->ascii;
     pline->zone_start = 0;
     pline->zone_stop = led_u8s_len(&pline_src->lstr);
     return pline;
 }
 
-inline bool led_line_isinit(led_line_t* pline) {
+LED_INLINE void led_line_swap(led_line_t** ppline, led_line_t** ppline_other) {
+    led_line_t* pline = *ppline;
+    *ppline = *ppline_other;
+    *ppline_other = pline;
+}
+
+LED_INLINE bool led_line_isinit(led_line_t* pline) {
     return led_u8s_isinit(&pline->lstr);
 }
 
-inline bool led_line_select(led_line_t* pline, bool selected) {
+LED_INLINE bool led_line_select(led_line_t* pline, bool selected) {
     pline->selected = selected;
     return selected;
 }
 
-inline bool led_line_isselected(led_line_t* pline) {
+LED_INLINE bool led_line_isselected(led_line_t* pline) {
     return pline->selected;
 }
 
-inline led_line_t* led_line_append_zone(led_line_t* pline, led_line_t* pline_src) {
+LED_INLINE led_line_t* led_line_append_zone(led_line_t* pline, led_line_t* pline_src) {
     led_u8s_app_zn(&pline->lstr, &pline_src->lstr, pline_src->zone_start, pline_src->zone_stop);
     return pline;
 }
 
-inline led_line_t* led_line_append_before_zone(led_line_t* pline, led_line_t* pline_src) {
+LED_INLINE led_line_t* led_line_append_before_zone(led_line_t* pline, led_line_t* pline_src) {
     led_u8s_app_zn(&pline->lstr, &pline_src->lstr, 0, pline_src->zone_start);
     return pline;
 }
 
-inline led_line_t* led_line_append_after_zone(led_line_t* pline, led_line_t* pline_src) {
+LED_INLINE led_line_t* led_line_append_after_zone(led_line_t* pline, led_line_t* pline_src) {
     led_u8s_app_zn(&pline->lstr, &pline_src->lstr, pline_src->zone_stop, pline_src->lstr.len);
     return pline;
 }
 
+//-----------------------------------------------
+// LED input reader
+// Input content is loaded by blocks and lines are given as views
+// on the block (no copy, not null terminated).
+// Big regular files are mapped in memory, small ones are loaded
+// with a single read and pipes are read by large blocks.
+//-----------------------------------------------
+
+#define LED_READER_NONE 0
+#define LED_READER_MMAP 1
+#define LED_READER_FILE 2
+#define LED_READER_STREAM 3
+#define LED_READER_MEM 4
+
+#define LED_READER_MMAP_MIN 0x100000
+#define LED_READER_BUF_MAX 0x40000
+
+typedef struct {
+    int type;
+    int fd;
+    char* map;
+    char* buf;
+    size_t buf_size;
+    char* data;
+    size_t len;
+    size_t pos;
+    size_t scan;
+    bool eof;
+    // UTF-8 check: bytes already validated from the data start,
+    // ASCII only validated window and input offset of the data start
+    size_t valid;
+    bool ascii;
+    size_t offset;
+} led_reader_t;
+
+void led_reader_open(led_reader_t* preader, int fd);
+void led_reader_open_mem(led_reader_t* preader, const char* data, size_t len);
+void led_reader_close(led_reader_t* preader);
+void led_reader_free(led_reader_t* preader);
+bool led_reader_fill(led_reader_t* preader);
+bool led_reader_check_block(led_reader_t* preader, const char* str, size_t len);
+bool led_reader_check_all(led_reader_t* preader);
+bool led_reader_check(led_reader_t* preader, led_u8s_t* lstr);
+
+LED_INLINE bool led_reader_isopen(led_reader_t* preader) {
+    return preader->type != LED_READER_NONE;
+}
+
+LED_INLINE bool led_reader_line(led_reader_t* preader, led_u8s_t* lstr) {
+    for (;;) {
+        char* start = preader->data + preader->pos;
+        size_t avail = preader->len - preader->pos;
+        // glibc memchr is vectorized, bytes already scanned are skipped
+        char* end = avail > preader->scan ? memchr(start + preader->scan, '\n', avail - preader->scan) : NULL;
+        if (end != NULL) {
+            lstr->str = start;
+            lstr->len = end - start;
+            lstr->size = lstr->len + 1;
+            preader->pos += lstr->len + 1;
+            preader->scan = 0;
+            return true;
+        }
+        preader->scan = avail;
+        if (preader->eof || !led_reader_fill(preader)) {
+            if (preader->pos < preader->len) {
+                // last line without final new line
+                lstr->str = preader->data + preader->pos;
+                lstr->len = preader->len - preader->pos;
+                lstr->size = lstr->len + 1;
+                preader->pos = preader->len;
+                preader->scan = 0;
+                return true;
+            }
+            led_u8s_reset(lstr);
+            return false;
+        }
+    }
+}
+
+//-----------------------------------------------
+// LED output writer
+// Output is accumulated in a large reusable buffer and written
+// to the file descriptor only when full or explicitly flushed.
+// The line buffered mode flushes at each new line (interactive tty).
+// The memory mode has no file descriptor, the buffer grows to keep
+// the whole output.
+//-----------------------------------------------
+
+#define LED_WRITER_BUF_MAX 0x40000
+
+typedef struct {
+    int fd;
+    char* buf;
+    size_t len;
+    size_t size;
+    bool linebuf;
+    bool mem;
+} led_writer_t;
+
+void led_writer_open(led_writer_t* pwriter, int fd, bool linebuf);
+void led_writer_open_mem(led_writer_t* pwriter);
+void led_writer_flush(led_writer_t* pwriter);
+void led_writer_close(led_writer_t* pwriter);
+void led_writer_free(led_writer_t* pwriter);
+void led_writer_direct(led_writer_t* pwriter, const char* str, size_t len);
+
+LED_INLINE bool led_writer_isopen(led_writer_t* pwriter) {
+    return pwriter->fd >= 0 && pwriter->buf != NULL;
+}
+
+LED_INLINE void led_writer_write(led_writer_t* pwriter, const char* str, size_t len) {
+    if (pwriter->len + len > pwriter->size) {
+        led_writer_direct(pwriter, str, len);
+        return;
+    }
+    memcpy(pwriter->buf + pwriter->len, str, len);
+    pwriter->len += len;
+    if (pwriter->linebuf && len > 0 && str[len-1] == '\n')
+        led_writer_flush(pwriter);
+}
+
+LED_INLINE void led_writer_write_u8s(led_writer_t* pwriter, led_u8s_t* lstr) {
+    led_writer_write(pwriter, lstr->str, lstr->len);
+}
+
+//-----------------------------------------------
+// LED command execution
+// Commands run concurrently on slots (-j), each one spawned with
+// /bin/sh -c or sent to a persistent shell of the slot. In batch mode
+// the lines are the args of a command spawned without shell.
+// The output of a command is collected in the slot and written when
+// it ends.
+//-----------------------------------------------
+
+typedef struct {
+    pid_t pid;
+    int fd;
+    int fd_in;
+    led_writer_t out;
+    size_t seq;
+    int status;
+    bool running;
+    bool done;
+} led_exec_slot_t;
+
+void led_exec_submit(const char* cmd);
+void led_exec_batch(const char* arg, size_t len);
+void led_exec_flush();
+void led_exec_free();
+
 //-----------------------------------------------
 // LED function management
 //-----------------------------------------------
 
+// translate pair of a multibyte source char
+#define LED_TR_DELETE 0xFFFFFFFF
+
+typedef struct {
+    u8c_t src;
+    u8c_t dst;
+} led_tr_pair_t;
+
+// replacement template segment, a view on the arg string or a register slot (reg >= 0)
+typedef struct {
+    size_t start;
+    size_t stop;
+    int reg;
+} led_tmpl_seg_t;
+
 typedef struct {
     size_t id;
-    pcre2_code* regex;
-    char tmp_buf[LED_BUF_MAX+1];
+    led_regex_t* regex;
 
     struct {
         led_u8s_t lstr;
         long val;
         size_t uval;
-        pcre2_code* regex;
+        led_regex_t* regex;
     } arg[LED_FARG_MAX];
     size_t arg_count;
+
+    // replacement template and substitute options compiled at init
+    struct {
+        led_tmpl_seg_t seg[LED_TMPL_SEG_MAX];
+        size_t seg_count;
+        bool hasreg;
+        uint32_t opts;
+    } tmpl;
+
+    // separator chars compiled at init
+    led_charset_t sep;
+
+    // field list compiled at init (cut/): fields bitmap, open range start and last needed field
+    struct {
+        uint64_t field[LED_CUT_FIELD_MAX / 64];
+        size_t from;
+        size_t last;
+    } cut;
+
+    // translate map compiled at init: single byte chars by a direct table,
+    // multibyte chars by sorted tables, the squeezed chars by a bitmap and a sorted table
+    struct {
+        u8c_t byte[256];
+        led_tr_pair_t* mb;
+        size_t mb_count;
+        bool squeeze;
+        uint8_t squeeze_byte[32];
+        u8c_t* squeeze_mb;
+        size_t squeeze_mb_count;
+        // ASCII to ASCII map without delete nor squeeze, by vector blocks
+        bool ascii;
+        uint8_t ascii_map[128];
+        uint8_t ascii_blocks;
+    } tr;
 } led_fn_t;
 
 typedef void (*led_fn_impl)(led_fn_t*);
@@ -602,6 +1068,34 @@ void led_fn_config();
 
 led_fn_desc_t* led_fn_table_descriptor(size_t fn_id);
 size_t led_fn_table_size();
+bool led_fn_isstateless(led_fn_t* pfunc);
+void led_fn_init_translate(led_fn_t* pfunc, size_t iarg);
+void led_fn_init_field_list(led_fn_t* pfunc, size_t iarg);
+void led_fn_init_base64(led_fn_t* pfunc, size_t iarg);
+void led_fn_init_hash(led_fn_t* pfunc, size_t iarg);
+void led_fn_free(led_fn_t* pfunc);
+
+//-----------------------------------------------
+// LED report stats, by stage of the line pipeline
+// the functions stats follow the fixed stages by position in the chain
+//-----------------------------------------------
+
+#define LED_STAT_READ 0
+#define LED_STAT_SEL 1
+#define LED_STAT_WRITE 2
+#define LED_STAT_EXEC 3
+#define LED_STAT_FUNC 4
+#define LED_STAT_MAX (LED_STAT_FUNC + LED_FUNC_MAX)
+
+typedef struct {
+    size_t count;
+    uint64_t time;
+    size_t bytes_in;
+    size_t bytes_out;
+    size_t match_count;
+    size_t nomatch_count;
+    size_t line_max;
+} led_stat_t;
 
 //-----------------------------------------------
 // LED runtime
@@ -614,7 +1108,10 @@ typedef struct {
     struct {
         bool help;
         bool verbose;
+        int trace;
+        int trace_level;
         bool report;
+        bool report_json;
         bool quiet;
         bool exit_mode;
         bool invert_selected;
@@ -622,11 +1119,19 @@ typedef struct {
         bool output_selected;
         bool output_match;
         bool filter_blank;
+        bool binary;
         int file_in;
         int file_out;
-        bool file_out_unchanged;
+        bool file_out_changed;
         bool file_out_extn;
         bool exec;
+        int exec_mode;
+        led_u8s_t exec_cmd;
+        size_t exec_batch_max;
+        size_t line_max;
+        size_t jobs;
+        bool jobs_unordered;
+        bool regex_nojit;
         led_u8s_t file_out_ext;
         led_u8s_t file_out_dir;
         led_u8s_t file_out_path;
@@ -635,11 +1140,11 @@ typedef struct {
     // selector
     struct {
         int type_start;
-        pcre2_code* regex_start;
+        led_regex_t* regex_start;
         size_t val_start;
 
         int type_stop;
-        pcre2_code* regex_stop;
+        led_regex_t* regex_stop;
         size_t val_stop;
 
         size_t total_count;
@@ -652,11 +1157,18 @@ typedef struct {
     led_fn_t func_list[LED_FUNC_MAX];
     size_t func_count;
 
+    // the regex matches are counted in the current stage stat (pstat) when reporting
     struct {
         size_t line_match_count;
+        size_t file_line_match_count;
         size_t file_in_count;
         size_t file_out_count;
         size_t file_match_count;
+        size_t exec_count;
+        size_t exec_fail_count;
+        size_t file_invalid_count;
+        led_stat_t stat[LED_STAT_MAX];
+        led_stat_t* pstat;
     } report;
 
     // files
@@ -670,45 +1182,197 @@ typedef struct {
         led_u8s_t name;
         char buf_name[LED_FNAME_MAX+1];
         FILE* file;
+        led_reader_t reader;
+        // invalid UTF-8 found, the file is skipped
+        bool invalid;
     } file_in;
     struct {
         led_u8s_t name;
         char buf_name[LED_FNAME_MAX+1];
         FILE* file;
+        led_writer_t writer;
+        // in place output is only written from the first difference with the input
+        bool deferred;
+        bool changed;
+        size_t same;
     } file_out;
 
     led_line_t line_read;
-    led_line_t line_prep;
-    led_line_t line_write;
+    // prep and write lines are swapped between functions (ping-pong buffers)
+    led_line_t line_pp[2];
+    led_line_t* line_prep;
+    led_line_t* line_write;
 
     led_line_t line_reg[LED_REG_MAX];
+    led_line_t line_subst;
+    led_line_t line_tmp;
+
+    led_arena_t arena;
+
+    // regex match context, each context has its own JIT stack and match data by regex id
+    struct {
+        pcre2_match_context* mctx;
+        pcre2_jit_stack* jit_stack;
+        pcre2_match_data** match_data;
+        size_t match_data_count;
+    } regex;
+
+    // command slots, outputs are written in submission order (seq)
+    // batch mode args are accumulated as null terminated strings
+    struct {
+        led_exec_slot_t* slots;
+        size_t slot_count;
+        size_t seq_in;
+        size_t seq_out;
+        char* cmd_buf;
+        char** cmd_argv;
+        size_t cmd_argc;
+        led_writer_t batch;
+        size_t batch_count;
+        size_t batch_size;
+        size_t batch_size_max;
+    } exec;
+
+    // grep mode, the selector regex is only run on lines holding its
+    // required literal or code unit (unit < 0 when none)
+    struct {
+        bool enabled;
+        int unit;
+        size_t lit_len;
+        char lit[LED_GREP_LIT_MAX];
+    } grep;
+
+    // worker pool context, the main context has the worker id 0
+    struct {
+        size_t id;
+        size_t task;
+    } worker;
+
+    // library context, errors jump back to the running API call
+    struct {
+        jmp_buf* jmp;
+        char** argv;
+        int argc;
+    } lib;
 
     PCRE2_UCHAR8 buf_message[LED_MSG_MAX+1];
 
 } led_t;
 
-extern led_t led;
+extern led_t led_main;
+
+// each thread runs on its own context, led is the current thread context
+extern __thread led_t* led_ctx;
+#define led (*led_ctx)
 
 void led_init(int argc, char* argv[]);
+void led_init_runtime();
 void led_free();
+void led_free_runtime();
 bool led_init_opt(led_u8s_t* arg);
 bool led_init_func(led_u8s_t* arg);
 bool led_init_sel(led_u8s_t* arg);
+void led_init_tmpl(led_fn_t* pfunc, size_t iarg);
+void led_init_tmpl_opts(led_fn_t* pfunc, size_t iarg);
 void led_init_config();
 void led_help();
 
 void led_file_open_in();
 void led_file_close_in();
+void led_file_invalid(size_t offset);
 void led_file_stdin();
 void led_file_open_out();
+void led_file_open_part();
+void led_file_write_deferred(const char* str, size_t len);
 void led_file_close_out();
 void led_file_print_out();
 void led_file_stdout();
 bool led_file_next();
 
+LED_INLINE bool led_file_out_isopen() {
+    return led.file_out.file != NULL || led.file_out.deferred;
+}
+
+LED_INLINE void led_file_write(const char* str, size_t len) {
+    if (led.file_out.deferred)
+        led_file_write_deferred(str, len);
+    else
+        led_writer_write(&led.file_out.writer, str, len);
+}
+void led_file_sel_reset();
+
 bool led_process_read();
 void led_process_write();
 void led_process_exec();
 bool led_process_selector();
 void led_process_functions();
-void led_report();
\ No newline at end of file
+void led_process_lines();
+void led_report();
+void led_report_merge(led_t* pctx);
+
+LED_INLINE uint64_t led_stat_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// a stage is timed only when reporting, its regex matches are counted until its end
+LED_INLINE uint64_t led_stat_begin(size_t istat) {
+    if (!led.opt.report) return 0;
+    led.report.pstat = &led.report.stat[istat];
+    return led_stat_clock();
+}
+
+LED_INLINE void led_stat_end(size_t istat, uint64_t start, size_t len_in, size_t len_out) {
+    if (!led.opt.report) return;
+    led_stat_t* pstat = &led.report.stat[istat];
+    pstat->time += led_stat_clock() - start;
+    pstat->count++;
+    pstat->bytes_in += len_in;
+    pstat->bytes_out += len_out;
+    if (len_in > pstat->line_max) pstat->line_max = len_in;
+    if (len_out > pstat->line_max) pstat->line_max = len_out;
+    led.report.pstat = NULL;
+}
+
+//-----------------------------------------------
+// LED worker pool
+//-----------------------------------------------
+
+// files are dispatched to workers by batches, biggest files first
+#define LED_POOL_BATCH 0x100
+// a single stream is dispatched by chunks of whole lines
+#define LED_POOL_CHUNK_SIZE 0x400000
+
+bool led_pool_isready();
+bool led_pool_isstateless();
+void led_pool_run();
+void led_pool_run_chunks();
+void led_pool_print_out();
+
+//-----------------------------------------------
+// LED grep mode
+// Without functions, lines are only filtered: the input block is
+// searched at once for candidate lines and whole blocks of lines
+// are written without being copied.
+//-----------------------------------------------
+
+void led_grep_init();
+void led_process_grep();
+// extract in lit the longest literal required by any match of the pattern
+size_t led_grep_literal(const char* pat, char* lit, size_t max);
+
+//-----------------------------------------------
+// LED library
+// A program (selector, processor and options given as command line
+// arguments) is compiled once in its own context and run over any
+// number of buffers or file descriptors. Errors are returned as
+// LED_ERR_* codes, the message is kept in the context.
+// A context must be used by one thread at a time.
+//-----------------------------------------------
+
+int led_lib_compile(led_t** ppctx, int argc, const char* argv[]);
+int led_lib_run_buf(led_t* pctx, const char* in, size_t in_len, const char** pout, size_t* pout_len);
+int led_lib_run_fd(led_t* pctx, int fd_in, int fd_out);
+const char* led_lib_message(led_t* pctx);
+void led_lib_free(led_t* pctx);
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+# led unicode tables generator
+# usage: ./led_case_gen.py > led_case.c
+# The tables come from the python unicodedata module (its Unicode version is written
+# in the generated file). Only the simple case mappings (one char to one char) are kept,
+# ASCII is handled inline in led.h and is left out of the tables.
+
+import os
+import unicodedata
+
+CODE_MAX = 0x110000
+
+
+def case_map(convert):
+    # code -> mapped code, for single char mappings only
+    mapping = {}
+    for code in range(0x80, CODE_MAX):
+        if 0xD800 <= code <= 0xDFFF:
+            continue
+        mapped = convert(chr(code))
+        if len(mapped) == 1 and ord(mapped) != code:
+            mapping[code] = ord(mapped)
+    return mapping
+
+
+def case_runs(mapping):
+    # runs of codes with the same delta, on contiguous codes (stride 1)
+    # or on alternating upper/lower pairs (stride 2)
+    runs = []
+    codes = sorted(mapping)
+    i = 0
+    while i < len(codes):
+        first = codes[i]
+        delta = mapping[first] - first
+        best = (1, 1)
+        for stride in (1, 2):
+            n = 1
+            while i + n < len(codes) and codes[i + n] == first + n * stride and mapping[codes[i + n]] - codes[i + n] == delta:
+                n += 1
+            if n > best[0]:
+                best = (n, stride)
+        n, stride = best
+        runs.append((first, first + (n - 1) * stride, delta, stride))
+        i += n
+    return runs
+
+
+def alnum_ranges():
+    ranges = []
+    start = None
+    for code in range(0x80, CODE_MAX + 1):
+        isalnum = code < CODE_MAX and chr(code).isalnum()
+        if isalnum and start is None:
+            start = code
+        elif not isalnum and start is not None:
+            ranges.append((start, code - 1))
+            start = None
+    return ranges
+
+
+def write_runs(name, runs):
+    print("const led_case_run_t %s[] = {" % name)
+    for first, last, delta, stride in runs:
+        print("    { 0x%05X, 0x%05X, %d, %d }," % (first, last, delta, stride))
+    print("};")
+    print("const size_t %s_count = sizeof %s / sizeof *%s;" % (name, name, name))
+    print()
+
+
+# same license header as the sources
+with open(os.path.join(os.path.dirname(os.path.abspath(__file__)), "led_io.c")) as f:
+    license = "".join(f.readlines()[:18])
+
+print(license)
+print('// Generated by led_case_gen.py (Unicode %s), do not edit.' % unicodedata.unidata_version)
+print()
+print('#include "led.h"')
+print()
+write_runs("led_case_lower", case_runs(case_map(str.lower)))
+write_runs("led_case_upper", case_runs(case_map(str.upper)))
+ranges = alnum_ranges()
+print("const led_case_range_t led_case_alnum[] = {")
+for first, last in ranges:
+    print("    { 0x%05X, 0x%05X }," % (first, last))
+print("};")
+print("const size_t led_case_alnum_count = sizeof led_case_alnum / sizeof *led_case_alnum;")
@@ -17,6 +17,8 @@
  USA
  ***************************************************************************/
 
+// external definitions of the led.h inline functions
+#define LED_INLINE extern inline
 #include "led.h"
 
 const char* LED_SEC_TABLE[] = {
@@ -26,13 +28,16 @@ const char* LED_SEC_TABLE[] = {
 };
 
 
-led_t led;
+led_t led_main;
+__thread led_t* led_ctx = &led_main;
 
 //-----------------------------------------------
 // LED tech trace and error functions
 //-----------------------------------------------
 
-void led_free() {
+void led_free_runtime() {
+    led_writer_free(&led.file_out.writer);
+    led_reader_free(&led.file_in.reader);
     if (led.opt.file_in && led.file_in.file) {
         fclose(led.file_in.file);
         led.file_in.file = NULL;
@@ -43,29 +48,56 @@ void led_free() {
         led.file_out.file = NULL;
         led_u8s_empty(&led.file_out.name);
     }
+    led_arena_free(&led.arena);
+    led_exec_free();
+    if (led.regex.mctx) {
+        pcre2_match_context_free(led.regex.mctx);
+        led.regex.mctx = NULL;
+    }
+    if (led.regex.jit_stack) {
+        pcre2_jit_stack_free(led.regex.jit_stack);
+        led.regex.jit_stack = NULL;
+    }
+    for (size_t id = 0; id < led.regex.match_data_count; id++)
+        pcre2_match_data_free(led.regex.match_data[id]);
+    free(led.regex.match_data);
+    led.regex.match_data = NULL;
+    led.regex.match_data_count = 0;
+    memset(&led.exec, 0, sizeof led.exec);
+    led.exec.batch.fd = -1;
+}
+
+void led_free() {
+    led_free_runtime();
+    // the configuration is shared with the workers and only freed by the main context
+    if (led.worker.id)
+        return;
     if (led.sel.regex_start != NULL) {
-        pcre2_code_free(led.sel.regex_start);
+        led_regex_release(led.sel.regex_start);
         led.sel.regex_start = NULL;
     }
     if (led.sel.regex_stop != NULL) {
-        pcre2_code_free(led.sel.regex_stop);
+        led_regex_release(led.sel.regex_stop);
         led.sel.regex_stop = NULL;
     }
     for(size_t i = 0; i < led.func_count; i++) {
         led_fn_t* pfunc = &led.func_list[i];
         if (pfunc->regex != NULL) {
             if (pfunc->regex != LED_REGEX_ALL_LINE) // will be deleted in a dedicated function.
-                pcre2_code_free(pfunc->regex);
+                led_regex_release(pfunc->regex);
             pfunc->regex = NULL;
         }
         for (size_t i = 0; i < pfunc->arg_count; i++) {
             if (pfunc->arg[i].regex != NULL) {
-                pcre2_code_free(pfunc->arg[i].regex);
+                led_regex_release(pfunc->arg[i].regex);
                 pfunc->arg[i].regex = NULL;
             }
         }
+        led_fn_free(pfunc);
     }
-    led_regex_free();
+    // the shared regex are kept while library contexts may use them
+    if (led_ctx == &led_main)
+        led_regex_free();
 }
 
 void led_assert(bool cond, int code, const char* message, ...) {
@@ -75,9 +107,16 @@ void led_assert(bool cond, int code, const char* message, ...) {
             va_start(args, message);
             vsnprintf((char*)led.buf_message, sizeof(led.buf_message), message, args);
             va_end(args);
-            fprintf(stderr, "\e[31m[LED_ERROR] %s\e[0m\n", led.buf_message);
         }
+        else
+            led.buf_message[0] = '\0';
+        // a library call returns the error code, the message stays in the context
+        if (led.lib.jmp)
+            longjmp(*led.lib.jmp, code);
+        // free first to flush pending output before the error message
         led_free();
+        if (message)
+            fprintf(stderr, "\e[31m[LED_ERROR] %s\e[0m\n", led.buf_message);
         exit(code);
     }
 }
@@ -85,8 +124,10 @@ void led_assert(bool cond, int code, const char* message, ...) {
 void led_assert_pcre(int rc) {
     if (rc < 0) {
         pcre2_get_error_message(rc, led.buf_message, LED_MSG_MAX);
-        fprintf(stderr, "\e[31m[LED_ERROR_PCRE] %s\e[0m\n", led.buf_message);
+        if (led.lib.jmp)
+            longjmp(*led.lib.jmp, LED_ERR_PCRE);
         led_free();
+        fprintf(stderr, "\e[31m[LED_ERROR_PCRE] %s\e[0m\n", led.buf_message);
         exit(LED_ERR_PCRE);
     }
 }
@@ -101,6 +142,16 @@ void led_debug(const char* message, ...) {
     }
 }
 
+const char* LED_TRACE_CAT[] = { "io", "sel", "func", "regex" };
+
+void led_trace_print(int cat, const char* message, ...) {
+    va_list args;
+    va_start(args, message);
+    vsnprintf((char*)led.buf_message, LED_MSG_MAX, message, args);
+    va_end(args);
+    fprintf(stderr, "\e[36m[LED_TRACE:%s] %s\e[0m\n", LED_TRACE_CAT[__builtin_ctz(cat)], led.buf_message);
+}
+
 //-----------------------------------------------
 // LED init functions
 //-----------------------------------------------
@@ -121,11 +172,36 @@ bool led_init_opt(led_u8s_t* arg) {
             case 'v':
                 led.opt.verbose = true;
                 break;
+            case 'T':
+#ifdef LED_TRACE
+                led.opt.trace_level = LED_TRACE_STEP;
+                for (; opti < arg->len; opti++) {
+                    switch (arg->str[opti]) {
+                    case 'i': led.opt.trace |= LED_TRACE_IO; break;
+                    case 's': led.opt.trace |= LED_TRACE_SEL; break;
+                    case 'f': led.opt.trace |= LED_TRACE_FUNC; break;
+                    case 'r': led.opt.trace |= LED_TRACE_REGEX; break;
+                    case 'a': led.opt.trace |= LED_TRACE_ALL; break;
+                    case '1': led.opt.trace_level = LED_TRACE_STEP; break;
+                    case '2': led.opt.trace_level = LED_TRACE_DETAIL; break;
+                    default: led_assert(false, LED_ERR_ARG, "Bad option -%c, unknown trace category: %c", opt, arg->str[opti]);
+                    }
+                }
+                if (!led.opt.trace) led.opt.trace = LED_TRACE_ALL;
+                led_debug("Option trace: %x level %d", led.opt.trace, led.opt.trace_level);
+#else
+                led_assert(false, LED_ERR_ARG, "Bad option -%c, traces are only available in the debug build (make debug)", opt);
+#endif
+                break;
             case 'q':
                 led.opt.quiet = true;
                 break;
             case 'r':
                 led.opt.report = true;
+                if (strncmp(optstr, "json", 4) == 0) {
+                    led.opt.report_json = true;
+                    opti += 4;
+                }
                 break;
             case 'x':
                 led.opt.exit_mode = LED_EXIT_VAL;
@@ -188,11 +264,54 @@ bool led_init_opt(led_u8s_t* arg) {
                 opti = arg->len;
                 break;
             case 'U':
-                led.opt.file_out_unchanged = true;
+                led.opt.file_out_changed = true;
+                break;
+            case 'L': {
+                char* unit = NULL;
+                led.opt.line_max = strtoul(optstr, &unit, 10);
+                if (*unit == 'K' || *unit == 'k') led.opt.line_max <<= 10;
+                else if (*unit == 'M' || *unit == 'm') led.opt.line_max <<= 20;
+                else if (*unit == 'G' || *unit == 'g') led.opt.line_max <<= 30;
+                led_assert(led.opt.line_max > 0, LED_ERR_ARG, "Bad option -%c, line maximum size expected: %s", opt, optstr);
+                led_debug("Option line max: %lu", led.opt.line_max);
+                opti = arg->len;
+                break;
+            }
+            case 'j': {
+                char* order = NULL;
+                led.opt.jobs = strtoul(optstr, &order, 10);
+                if (led.opt.jobs == 0) led.opt.jobs = sysconf(_SC_NPROCESSORS_ONLN);
+                led.opt.jobs_unordered = *order == 'c';
+                led_assert(*order == '\0' || *order == 'c', LED_ERR_ARG, "Bad option -%c, jobs count and order expected: %s", opt, optstr);
+                led_debug("Option jobs: %lu (unordered: %d)", led.opt.jobs, led.opt.jobs_unordered);
+                opti = arg->len;
+                break;
+            }
+            case 'I':
+                led.opt.regex_nojit = true;
+                break;
+            case 'B':
+                led.opt.binary = true;
                 break;
             case 'X':
                 led_assert(!led.opt.file_out, LED_ERR_ARG, "Bad option -%c, output file mode already set", opt);
                 led.opt.exec = true;
+                if (*optstr == 's') {
+                    led.opt.exec_mode = LED_EXEC_SHELL;
+                    opti++;
+                }
+                else if (*optstr == 'b') {
+                    // -Xb[N:]<command>, at most N args by command
+                    char* cmd = NULL;
+                    led.opt.exec_mode = LED_EXEC_BATCH;
+                    led.opt.exec_batch_max = strtoul(optstr + 1, &cmd, 10);
+                    if (*cmd == ':') cmd++;
+                    else cmd = optstr + 1;
+                    led_u8s_init_str(&led.opt.exec_cmd, cmd);
+                    led_assert(!led_u8s_isempty(&led.opt.exec_cmd), LED_ERR_ARG, "Bad option -%c, batch command expected", opt);
+                    opti = arg->len;
+                }
+                led_debug("Option exec mode: %d", led.opt.exec_mode);
                 break;
             default:
                 led_assert(false, LED_ERR_ARG, "Unknown option: -%c", opt);
@@ -289,7 +408,58 @@ bool led_init_sel(led_u8s_t* arg) {
     return rc;
 }
 
+void led_init_tmpl(led_fn_t* pfunc, size_t iarg) {
+    // the replacement is cut in literal segments and $R register slots
+    led_u8s_t* ptmpl = &pfunc->arg[iarg].lstr;
+    pfunc->tmpl.seg_count = 0;
+    pfunc->tmpl.hasreg = false;
+    size_t start = 0;
+    size_t i = 0;
+    while (i <= led_u8s_len(ptmpl)) {
+        bool isreg = led_u8s_startswith_str_at(ptmpl, "$R", i);
+        if (!isreg && i < led_u8s_len(ptmpl)) {
+            i++;
+            continue;
+        }
+        if (i > start) {
+            led_assert(pfunc->tmpl.seg_count < LED_TMPL_SEG_MAX, LED_ERR_ARG, "function arg %i: too many segments in template (max %d)", iarg+1, LED_TMPL_SEG_MAX);
+            pfunc->tmpl.seg[pfunc->tmpl.seg_count++] = (led_tmpl_seg_t){ start, i, -1 };
+        }
+        if (!isreg) break;
+
+        int ir = 0;
+        i += 2;
+        if (i < led_u8s_len(ptmpl) && led_u8c_isdigit(led_u8s_char_at(ptmpl, i)))
+            ir = led_u8s_char_at(ptmpl, i++) - '0';
+        led_assert(pfunc->tmpl.seg_count < LED_TMPL_SEG_MAX, LED_ERR_ARG, "function arg %i: too many segments in template (max %d)", iarg+1, LED_TMPL_SEG_MAX);
+        pfunc->tmpl.seg[pfunc->tmpl.seg_count++] = (led_tmpl_seg_t){ 0, 0, ir };
+        pfunc->tmpl.hasreg = true;
+        start = i;
+        led_debug("function arg %i: template register %d", iarg+1, ir);
+    }
+    led_debug("function arg %i: template found: %s (%lu segments)", iarg+1, led_u8s_str(ptmpl), pfunc->tmpl.seg_count);
+}
+
+void led_init_tmpl_opts(led_fn_t* pfunc, size_t iarg) {
+    size_t i = 0;
+    while (i < led_u8s_len(&pfunc->arg[iarg].lstr))
+        switch (led_u8s_char_next(&pfunc->arg[iarg].lstr, &i)) {
+            case 'g':
+                pfunc->tmpl.opts |= PCRE2_SUBSTITUTE_GLOBAL;
+                break;
+            case 'e':
+                pfunc->tmpl.opts |= PCRE2_SUBSTITUTE_EXTENDED;
+                break;
+            case 'l':
+                pfunc->tmpl.opts |= PCRE2_SUBSTITUTE_LITERAL;
+                break;
+            default:
+                break;
+        }
+}
+
 void led_init_config() {
+    led_fn_config();
     for (size_t ifunc = 0; ifunc < led.func_count; ifunc++) {
         led_fn_t* pfunc = &led.func_list[ifunc];
 
@@ -339,10 +509,52 @@ void led_init_config() {
                     led_debug("function arg %i: positive numeric found: %lu", i+1, pfunc->arg[i].uval);
                 }
             }
+            else if (format[i] == 'T') {
+                led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing string\n%s", i+1, pfn_desc->help_format);
+                led_init_tmpl(pfunc, i);
+            }
+            else if (format[i] == 'o') {
+                if (led_u8s_isinit(&pfunc->arg[i].lstr)) {
+                    led_init_tmpl_opts(pfunc, i);
+                    led_debug("function arg %i: options found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
+                }
+            }
             else if (format[i] == 'S') {
                 led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing string\n%s", i+1, pfn_desc->help_format);
                 led_debug("function arg %i: string found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
             }
+            else if (format[i] == 'C') {
+                led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing chars\n%s", i+1, pfn_desc->help_format);
+                led_charset_init(&pfunc->sep, &pfunc->arg[i].lstr);
+                led_debug("function arg %i: chars found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
+            }
+            else if (format[i] == 'c') {
+                if (led_u8s_isinit(&pfunc->arg[i].lstr)) {
+                    led_charset_init(&pfunc->sep, &pfunc->arg[i].lstr);
+                    led_debug("function arg %i: chars found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
+                }
+            }
+            else if (format[i] == 'L') {
+                led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing field list\n%s", i+1, pfn_desc->help_format);
+                led_fn_init_field_list(pfunc, i);
+            }
+            else if (format[i] == 'b') {
+                if (led_u8s_isinit(&pfunc->arg[i].lstr)) {
+                    led_fn_init_base64(pfunc, i);
+                    led_debug("function arg %i: base64 options found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
+                }
+            }
+            else if (format[i] == 'H') {
+                // hash algo, the next arg gives the output encoding
+                led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing hash algo\n%s", i+1, pfn_desc->help_format);
+                led_fn_init_hash(pfunc, i);
+                led_debug("function arg %i: hash algo found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
+            }
+            else if (format[i] == 'M') {
+                // translate map from this char set, the next args give the target set and the options
+                led_assert(led_u8s_isinit(&pfunc->arg[i].lstr), LED_ERR_ARG, "function arg %i: missing chars\n%s", i+1, pfn_desc->help_format);
+                led_fn_init_translate(pfunc, i);
+            }
             else if (format[i] == 's') {
                 if (led_u8s_isinit(&pfunc->arg[i].lstr)) {
                     led_debug("function arg %i: string found: %s", i+1, led_u8s_str(&pfunc->arg[i].lstr));
@@ -358,10 +570,9 @@ void led_init_config() {
 void led_init(int argc, char* argv[]) {
     led_debug("Init");
 
+    // the context is expected zeroed (static main context or allocated library context)
     led_regex_init();
 
-    memset(&led, 0, sizeof(led));
-
     led.stdin_ispipe = !isatty(fileno(stdin));
     led.stdout_ispipe = !isatty(fileno(stdout));
 
@@ -372,9 +583,11 @@ void led_init(int argc, char* argv[]) {
         led_u8s_decl_str(arg, argv[argi]);
 
         if (arg_section == ARGS_SEC_FILES) {
+            // all the remaining args are file names
             led.file_names = argv + argi;
             led.file_count = argc - argi;
-            led_debug("Arg is file: %s", led_u8s_str(&arg));
+            led_debug("Arg is file: %s (%d files)", led_u8s_str(&arg), led.file_count);
+            break;
         }
         else if (arg_section < ARGS_SEC_FILES && led_init_opt(&arg)) {
             if (led.opt.file_in) arg_section = ARGS_SEC_FILES;
@@ -395,23 +608,48 @@ void led_init(int argc, char* argv[]) {
     // if a process function is not defined show only selected
     led.opt.output_selected = led.opt.output_selected || led.func_count == 0;
 
-    // init led_u8s_t file names with their buffers.
-    led_u8s_init_buf(&led.file_in.name, led.file_in.buf_name);
-    led_u8s_init_buf(&led.file_out.name, led.file_out.buf_name);
-
-    led_line_reset(&led.line_read);
-    led_line_reset(&led.line_prep);
-    led_line_reset(&led.line_write);
-    for (size_t i=0; i<LED_REG_MAX; i++)
-        led_line_reset(&led.line_reg[i]);
+    led_init_runtime();
 
     // pre-configure the processor command
     led_init_config();
+    led_grep_init();
+
+    // jobs run files on workers, or chunks of the input when the program is stateless
+    // commands run on N slots while the lines are processed serially
+    if (led.opt.jobs > 1 && !led.opt.exec && !led_pool_isready() && !led_pool_isstateless())
+        led.opt.jobs = 0;
 
     led_debug("Config sel count: %d", led.sel.count);
     led_debug("Config func count: %d", led.func_count);
 }
 
+void led_init_runtime() {
+    // init led_u8s_t file names with their buffers.
+    led_u8s_init_buf(&led.file_in.name, led.file_in.buf_name);
+    led_u8s_init_buf(&led.file_out.name, led.file_out.buf_name);
+    led.file_out.writer.fd = -1;
+
+    // all line buffers grow from the run arena up to the line maximum size
+    led.arena.max = led.opt.line_max ? led.opt.line_max : LED_LINE_MAX;
+    led_line_setup(&led.line_read, &led.arena);
+    led.line_prep = led_line_setup(&led.line_pp[0], &led.arena);
+    led.line_write = led_line_setup(&led.line_pp[1], &led.arena);
+    for (size_t i=0; i<LED_REG_MAX; i++)
+        led_line_setup(&led.line_reg[i], &led.arena);
+    led_line_setup(&led.line_subst, &led.arena);
+    led_line_setup(&led.line_tmp, &led.arena);
+
+    // the JIT stack is assigned to the context match context (one per thread)
+    // the match data are created on first use of each regex by this context
+    led.regex.match_data = NULL;
+    led.regex.match_data_count = 0;
+    led.regex.mctx = pcre2_match_context_create(led_regex_gctx());
+    led.regex.jit_stack = pcre2_jit_stack_create(LED_REGEX_JIT_STACK_MIN, LED_REGEX_JIT_STACK_MAX, led_regex_gctx());
+    led_assert(led.regex.mctx != NULL, LED_ERR_INTERNAL, "Regex match context allocation error");
+    if (led.regex.jit_stack)
+        pcre2_jit_stack_assign(led.regex.mctx, NULL, led.regex.jit_stack);
+}
+
 void led_help() {
     const char* DASHS = "----------------------------------------------------------------------------------------------------";
     fprintf(stderr,
@@ -440,9 +678,14 @@ for simple automatic word processing based on PCRE2 modern regular expressions.\
 \n\
 ## Global options\n\
     -v  verbose to STDERR\n\
-    -r  report to STDERR\n\
+    -T[i][s][f][r][a][1|2]\n\
+        per line traces to STDERR by category (io, selector, functions, regex, all) and level (debug build only)\n\
+    -r  report to STDERR, counters and time of each stage (read, selector, functions, write, exec)\n\
+        -rjson writes the report as a JSON object\n\
     -q  quiet, do not ouptut anything (exit code only)\n\
     -e  exit code on value\n\
+    -I  interpreted regex, PCRE2 JIT disabled\n\
+    -B  binary input, the UTF-8 input check is disabled\n\
 \n\
 ## Selector Options:\n\
     -n  invert selection\n\
@@ -453,12 +696,20 @@ for simple automatic word processing based on PCRE2 modern regular expressions.\
     -f          read filenames from STDIN instead of content or from command line if followed file names (file section)\n\
 \n\
 ## File output options:\n\
-    -F          modify files inplace\n\
+    -F          modify files inplace, unchanged files are not rewritten\n\
+    -U          with -F, do not output the unchanged filenames\n\
     -W<path>    write content to a fixed file\n\
     -A<path>    append content to a fixed file\n\
     -E<ext>     write content to <current filename>.<ext>\n\
     -D<dir>     write files in <dir>.\n\
-    -X          execute lines.\n\
+    -X[s]       execute lines, with s in persistent shells, on N slots with -jN (c: completion order)\n\
+    -Xb[N:]<command>\n\
+                execute <command> with the lines as args, by batches of N args or up to the system limit\n\
+                the outputs are not mixed, the exit code is 6 when a command fails\n\
+    -L<size>    maximum line size (K, M, G units accepted, default 256M)\n\
+    -j[N][c]    process files on N worker threads (default CPU count) with -F, -E, -D\n\
+                output filenames in input order or in completion order with c\n\
+                other modes process chunks of the input in parallel when lines are independent\n\
 \n\
     All these options output the output filenames on STDOUT\n\
 \n\
@@ -492,53 +743,92 @@ for simple automatic word processing based on PCRE2 modern regular expressions.\
 
 void led_file_open_in() {
     led_debug("led_file_open_in");
-    if (led.file_count) {
-        led_u8s_cpy_chars(&led.file_in.name, led.file_names[0]);
-        led.file_names++;
-        led.file_count--;
-        led_u8s_trim(&led.file_in.name);
-        led_debug("open file from args: %s", led_u8s_str(&led.file_in.name));
-        led.file_in.file = fopen(led_u8s_str(&led.file_in.name), "r");
-        led_assert(led.file_in.file != NULL, LED_ERR_FILE, "File not found: %s", led_u8s_str(&led.file_in.name));
-        led.report.file_in_count++;
-    }
-    else if (led.stdin_ispipe) {
-        char buf_fname[LED_FNAME_MAX+1];
-        char* fname = fgets(buf_fname, LED_FNAME_MAX, stdin);
-        if (fname) {
-            led_u8s_cpy_chars(&led.file_in.name, fname);
+    // the fully loaded files with invalid UTF-8 are skipped before any output
+    do {
+        if (led.file_in.file)
+            led_file_close_in();
+        if (led.file_count) {
+            led_u8s_cpy_chars(&led.file_in.name, led.file_names[0]);
+            led.file_names++;
+            led.file_count--;
             led_u8s_trim(&led.file_in.name);
-            led_debug("open file from stdin: [%s]", led_u8s_str(&led.file_in.name));
+            led_debug("open file from args: %s", led_u8s_str(&led.file_in.name));
             led.file_in.file = fopen(led_u8s_str(&led.file_in.name), "r");
             led_assert(led.file_in.file != NULL, LED_ERR_FILE, "File not found: %s", led_u8s_str(&led.file_in.name));
+            led_reader_open(&led.file_in.reader, fileno(led.file_in.file));
             led.report.file_in_count++;
         }
-    }
+        else if (led.stdin_ispipe) {
+            char buf_fname[LED_FNAME_MAX+1];
+            char* fname = fgets(buf_fname, LED_FNAME_MAX, stdin);
+            if (fname) {
+                led_u8s_cpy_chars(&led.file_in.name, fname);
+                led_u8s_trim(&led.file_in.name);
+                led_debug("open file from stdin: [%s]", led_u8s_str(&led.file_in.name));
+                led.file_in.file = fopen(led_u8s_str(&led.file_in.name), "r");
+                led_assert(led.file_in.file != NULL, LED_ERR_FILE, "File not found: %s", led_u8s_str(&led.file_in.name));
+                led_reader_open(&led.file_in.reader, fileno(led.file_in.file));
+                led.report.file_in_count++;
+            }
+        }
+    } while (led.file_in.file && !led.opt.binary && led.file_in.reader.eof && !led_reader_check_all(&led.file_in.reader));
 }
 
 void led_file_close_in() {
+    led_reader_close(&led.file_in.reader);
     fclose(led.file_in.file);
     led.file_in.file = NULL;
+    led.file_in.invalid = false;
     led_u8s_empty(&led.file_in.name);
 }
 
+void led_file_invalid(size_t offset) {
+    // a single input stream stops, an input file is reported and skipped, the error code is returned at the end
+    led_assert(led.opt.file_in, LED_ERR_FILE, "Invalid UTF-8 input at offset %lu (use -B for binary input)", offset);
+    fprintf(stderr, "\e[31m[LED_ERROR] Invalid UTF-8 input at offset %lu, file skipped (use -B for binary input): %s\e[0m\n",
+        offset, led_u8s_str(&led.file_in.name));
+    led.file_in.invalid = true;
+    led.report.file_invalid_count++;
+}
+
+static void led_file_drop_out() {
+    // the partial output of a file found invalid while streamed is removed
+    led_writer_close(&led.file_out.writer);
+    fclose(led.file_out.file);
+    led.file_out.file = NULL;
+    remove(led_u8s_str(&led.file_out.name));
+    led_debug("Output removed: %s", led_u8s_str(&led.file_out.name));
+    led_u8s_empty(&led.file_out.name);
+}
+
 void led_file_stdin() {
     if (led.file_in.file) {
         led_assert(led.file_in.file == stdin, LED_ERR_FILE, "File is not STDIN internal error: %s", led_u8s_str(&led.file_in.name));
+        led_reader_close(&led.file_in.reader);
         led.file_in.file = NULL;
         led_u8s_empty(&led.file_in.name);
     } else if (led.stdin_ispipe) {
         led.file_in.file = stdin;
         led_u8s_cpy_chars(&led.file_in.name, "STDIN");
+        led_reader_open(&led.file_in.reader, fileno(stdin));
     }
 }
 
 void led_file_open_out() {
     const char* mode = "";
+    led.file_out.changed = true;
     if (led.opt.file_out == LED_OUTPUT_FILE_INPLACE) {
         led_u8s_cpy(&led.file_out.name, &led.file_in.name);
         led_u8s_app_str(&led.file_out.name, ".part");
         mode = "w+";
+        // a fully loaded input is compared with the output, the part file is created on the first difference
+        if (led.file_in.reader.eof) {
+            led_debug("Output deferred: %s", led_u8s_str(&led.file_out.name));
+            led.file_out.deferred = true;
+            led.file_out.changed = false;
+            led.file_out.same = 0;
+            return;
+        }
     }
     else if (led.opt.file_out == LED_OUTPUT_FILE_WRITE) {
         led_u8s_cpy(&led.file_out.name, &led.opt.file_out_path);
@@ -564,13 +854,50 @@ void led_file_open_out() {
     }
     led.file_out.file = fopen(led_u8s_str(&led.file_out.name), mode);
     led_assert(led.file_out.file != NULL, LED_ERR_FILE, "File open error: %s", led_u8s_str(&led.file_out.name));
+    led_writer_open(&led.file_out.writer, fileno(led.file_out.file), false);
     led.report.file_out_count++;
 }
 
+void led_file_open_part() {
+    led.file_out.deferred = false;
+    led.file_out.changed = true;
+    led.file_out.file = fopen(led_u8s_str(&led.file_out.name), "w+");
+    led_assert(led.file_out.file != NULL, LED_ERR_FILE, "File open error: %s", led_u8s_str(&led.file_out.name));
+    led_writer_open(&led.file_out.writer, fileno(led.file_out.file), false);
+    led.report.file_out_count++;
+    // the identical beginning is written from the input
+    led_writer_write(&led.file_out.writer, led.file_in.reader.data, led.file_out.same);
+    led_debug("Output changed at %lu: %s", led.file_out.same, led_u8s_str(&led.file_out.name));
+}
+
+void led_file_write_deferred(const char* str, size_t len) {
+    led_reader_t* preader = &led.file_in.reader;
+    const char* same = preader->data + led.file_out.same;
+    if (led.file_out.same + len <= preader->len && (str == same || memcmp(same, str, len) == 0)) {
+        led.file_out.same += len;
+        return;
+    }
+    led_file_open_part();
+    led_writer_write(&led.file_out.writer, str, len);
+}
+
 void led_file_close_out() {
     led_u8s_decl(tmp, LED_FNAME_MAX+1);
 
-    fclose(led.file_out.file);
+    if (led.file_out.deferred) {
+        if (led.file_out.same == led.file_in.reader.len) {
+            // unchanged file, nothing is written
+            led.file_out.deferred = false;
+            led_u8s_trunk_end(&led.file_out.name, 5);
+            led_debug("Output unchanged: %s", led_u8s_str(&led.file_out.name));
+            return;
+        }
+        // the output is a truncated input
+        led_file_open_part();
+    }
+    led_writer_close(&led.file_out.writer);
+    if (led.file_out.file != stdout)
+        fclose(led.file_out.file);
     led.file_out.file = NULL;
     if (led.opt.file_out == LED_OUTPUT_FILE_INPLACE) {
         led_u8s_cpy(&tmp, &led.file_out.name);
@@ -585,23 +912,44 @@ void led_file_close_out() {
 }
 
 void led_file_print_out() {
+    if (led.opt.file_out_changed && !led.file_out.changed) {
+        led_u8s_empty(&led.file_out.name);
+        return;
+    }
+    if (led.worker.id) {
+        // workers hand the output filename to the pool that keeps the output order
+        led_pool_print_out();
+        led_u8s_empty(&led.file_out.name);
+        return;
+    }
     fwrite(led_u8s_str(&led.file_out.name), sizeof *led_u8s_str(&led.file_out.name), led_u8s_len(&led.file_out.name), stdout);
     fwrite("\n", sizeof *led_u8s_str(&led.file_out.name), 1, stdout);
-    fflush(stdout);
+    // stdout stream is line buffered on a tty and fully buffered on a pipe
     led_u8s_empty(&led.file_out.name);
 }
 
 void led_file_stdout() {
     led.file_out.file = stdout;
     led_u8s_cpy_chars(&led.file_out.name, "STDOUT");
+    // line buffered mode is only used on an interactive terminal
+    led_writer_open(&led.file_out.writer, fileno(stdout), !led.stdout_ispipe);
 }
 
 bool led_file_next() {
     led_debug("Next file ---------------------------------------------------");
 
-    if (led.opt.file_out && led.file_out.file && ! (led.opt.file_out == LED_OUTPUT_FILE_WRITE || led.opt.file_out == LED_OUTPUT_FILE_APPEND)) {
-        led_file_close_out();
-        led_file_print_out();
+    if (led.opt.file_out && led_file_out_isopen() && ! (led.opt.file_out == LED_OUTPUT_FILE_WRITE || led.opt.file_out == LED_OUTPUT_FILE_APPEND)) {
+        if (led.file_in.invalid && !led.file_out.deferred)
+            led_file_drop_out();
+        else {
+            led_file_close_out();
+            led_file_print_out();
+        }
+    }
+
+    if (led.file_in.file && led.report.file_line_match_count) {
+        led.report.file_match_count++;
+        led.report.file_line_match_count = 0;
     }
 
     if (led.opt.file_in && led.file_in.file)
@@ -612,79 +960,92 @@ bool led_file_next() {
     else
         led_file_stdin();
 
-    if (! led.file_out.file && led.file_in.file) {
+    if (! led_file_out_isopen() && led.file_in.file) {
         if (led.opt.file_out)
             led_file_open_out();
         else
             led_file_stdout();
     }
 
-    if (! led.file_in.file && led.file_out.file) {
+    if (! led.file_in.file && led_file_out_isopen()) {
         led_file_close_out();
-        led_file_print_out();
+        if (led.opt.file_out)
+            led_file_print_out();
     }
 
     led_debug("Input from: %s", led_u8s_str(&led.file_in.name));
     led_debug("Output to: %s", led_u8s_str(&led.file_out.name));
 
+    led_file_sel_reset();
+    return led.file_in.file != NULL;
+}
+
+void led_file_sel_reset() {
     led.sel.total_count = 0;
     led.sel.count = 0;
     led.sel.selected = false;
     led.sel.inboundary = false;
-    return led.file_in.file != NULL;
 }
 
 bool led_process_read() {
-    led_debug("led_process_read");
+    led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "led_process_read");
     if (!led_line_isinit(&led.line_read)) {
-        led_u8s_init(&led.line_read.lstr, fgets(led.line_read.buf, sizeof led.line_read.buf, led.file_in.file), sizeof led.line_read.buf);
-        if (led_line_isinit(&led.line_read)) {
-            led_u8s_trunk_char(&led.line_read.lstr, '\n');
+        uint64_t start = led_stat_begin(LED_STAT_READ);
+        // the read line is a view on the input block (not null terminated)
+        if (led_reader_line(&led.file_in.reader, &led.line_read.lstr)) {
             led.line_read.zone_start = 0;
             led.line_read.zone_stop = led.line_read.lstr.len;
             led.line_read.selected = false;
+            led.line_read.ascii = !led.opt.binary && led_reader_check(&led.file_in.reader, &led.line_read.lstr);
+            if (led.file_in.invalid) {
+                // the rest of an invalid input file is skipped
+                led_line_reset(&led.line_read);
+                return false;
+            }
             led.sel.total_count++;
-            led_debug("Read line: (%d) len=%d", led.sel.total_count, led.line_read.lstr.len);
+            led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Read line: (%d) len=%d", led.sel.total_count, led.line_read.lstr.len);
+            led_stat_end(LED_STAT_READ, start, led.line_read.lstr.len, led.line_read.lstr.len);
         }
         else
-            led_debug("Read line is NULL: (%d)", led.sel.total_count);
+            led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Read line is NULL: (%d)", led.sel.total_count);
     }
     return led_line_isinit(&led.line_read);
 }
 
 void led_process_write() {
-    led_debug("led_process_write");
-    if (led_line_isinit(&led.line_write)) {
-        led_debug("Write line: (%d) len=%d", led.sel.total_count, led_u8s_len(&led.line_write.lstr));
-        led_u8s_app_char(&led.line_write.lstr, '\n');
-        led_debug("Write line to %s", led_u8s_str(&led.file_out.name));
-        fwrite(led_u8s_str(&led.line_write.lstr), sizeof *led_u8s_str(&led.line_write.lstr), led_u8s_len(&led.line_write.lstr), led.file_out.file);
-        fflush(led.file_out.file);
+    led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "led_process_write");
+    if (led_line_isinit(led.line_write)) {
+        led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Write line: (%d) len=%d", led.sel.total_count, led_u8s_len(&led.line_write->lstr));
+        led_u8s_app_char(&led.line_write->lstr, '\n');
+        led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "Write line to %s", led_u8s_str(&led.file_out.name));
+        uint64_t start = led_stat_begin(LED_STAT_WRITE);
+        led_file_write(led_u8s_str(&led.line_write->lstr), led_u8s_len(&led.line_write->lstr));
+        led_stat_end(LED_STAT_WRITE, start, led_u8s_len(&led.line_write->lstr), led_u8s_len(&led.line_write->lstr));
     }
-    led_line_reset(&led.line_write);
+    led_line_reset(led.line_write);
 }
 
 void led_process_exec() {
-    led_debug("led_process_exec");
-    if (led_line_isinit(&led.line_write) && !led_u8s_isblank(&led.line_write.lstr)) {
-        led_debug("Exec line: (%d) len=%d", led.sel.total_count, led_u8s_len(&led.line_write.lstr));
-        led_debug("Exec command %s", led_u8s_str(&led.line_write.lstr));
-
-        FILE *fp = popen(led_u8s_str(&led.line_write.lstr), "r");
-        led_assert(fp != NULL, LED_ERR_ARG, "Command error");
-        led_u8s_decl(output, 4096);
-        while (led_u8s_isinit(led_u8s_init(&output, fgets(led_u8s_str(&output), led_u8s_size(&output), fp), led_u8s_size(&output)))) {
-            fwrite(led_u8s_str(&output), sizeof *led_u8s_str(&output), led_u8s_len(&output), led.file_out.file);
-            fflush(led.file_out.file);
-        }
-        pclose(fp);
+    led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "led_process_exec");
+    if (led_line_isinit(led.line_write) && !led_u8s_isblank(&led.line_write->lstr)) {
+        led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Exec line: (%d) len=%d", led.sel.total_count, led_u8s_len(&led.line_write->lstr));
+        uint64_t start = led_stat_begin(LED_STAT_EXEC);
+        if (led.opt.exec_mode == LED_EXEC_BATCH)
+            led_exec_batch(led_u8s_str(&led.line_write->lstr), led_u8s_len(&led.line_write->lstr));
+        else
+            led_exec_submit(led_u8s_str(&led.line_write->lstr));
+        led_stat_end(LED_STAT_EXEC, start, led_u8s_len(&led.line_write->lstr), 0);
     }
-    led_line_reset(&led.line_write);
+    led_line_reset(led.line_write);
 }
 
 bool led_process_selector() {
-    led_debug("led_process_selector");
+    led_trace(LED_TRACE_SEL, LED_TRACE_DETAIL, "led_process_selector");
 
+    // the last call without line only flushes the pack, it is not counted
+    bool isline = led_line_isinit(&led.line_read);
+    size_t len_in = isline ? led.line_read.lstr.len : 0;
+    uint64_t start = isline ? led_stat_begin(LED_STAT_SEL) : 0;
     bool ready = false;
     // stop selection on stop boundary
     if (!led_line_isinit(&led.line_read)
@@ -711,80 +1072,184 @@ bool led_process_selector() {
     led.sel.selected = led.sel.inboundary && led.sel.shift == 0;
     led.line_read.selected = led.sel.selected == !led.opt.invert_selected;
 
-    led_debug("Select: inboundary=%d, shift=%d selected=%d line selected=%d", led.sel.inboundary, led.sel.shift, led.sel.selected, led.line_read.selected);
+    led_trace(LED_TRACE_SEL, LED_TRACE_STEP, "Select: inboundary=%d, shift=%d selected=%d line selected=%d", led.sel.inboundary, led.sel.shift, led.sel.selected, led.line_read.selected);
 
     if (led.sel.selected) led.sel.count++;
 
     if (led.opt.pack_selected) {
         if (led_line_isselected(&led.line_read)) {
-            led_debug("pack: append to ready");
+            led_trace(LED_TRACE_SEL, LED_TRACE_DETAIL, "pack: append to ready");
             if (!(led.opt.filter_blank && led_u8s_isblank(&led.line_read.lstr))) {
-                if (led_u8s_iscontent(&led.line_prep.lstr))
-                    led_u8s_app_char(&led.line_prep.lstr, '\n');
-                led_u8s_app(&led.line_prep.lstr, &led.line_read.lstr);
+                if (!led_line_isinit(led.line_prep))
+                    led_line_init(led.line_prep);
+                else if (led_u8s_iscontent(&led.line_prep->lstr))
+                    led_u8s_app_char(&led.line_prep->lstr, '\n');
+                led_u8s_app(&led.line_prep->lstr, &led.line_read.lstr);
             }
-            led_line_select(&led.line_prep, true);
+            led_line_select(led.line_prep, true);
             led_line_reset(&led.line_read);
         }
-        else if (led_line_isselected(&led.line_prep)) {
-            led_debug("pack: ready to process");
+        else if (led_line_isselected(led.line_prep)) {
+            led_trace(LED_TRACE_SEL, LED_TRACE_DETAIL, "pack: ready to process");
             ready = true;
         }
         else {
-            led_debug("pack: no selection");
+            led_trace(LED_TRACE_SEL, LED_TRACE_DETAIL, "pack: no selection");
             if (!(led.opt.filter_blank && led_u8s_isblank(&led.line_read.lstr)))
-                led_line_cpy(&led.line_prep, &led.line_read);
+                led_line_cpy(led.line_prep, &led.line_read);
             led_line_reset(&led.line_read);
             ready = true;
         }
     }
     else {
         if (!(led.opt.filter_blank && led_u8s_isblank(&led.line_read.lstr)))
-            led_line_cpy(&led.line_prep, &led.line_read);
+            led_line_cpy(led.line_prep, &led.line_read);
         led_line_reset(&led.line_read);
         ready = true;
     }
 
-    led_debug("Line ready to process: %d", ready);
+    led_trace(LED_TRACE_SEL, LED_TRACE_STEP, "Line ready to process: %d", ready);
+    if (isline)
+        led_stat_end(LED_STAT_SEL, start, len_in, ready && led_line_isselected(led.line_prep) ? led.line_prep->lstr.len : 0);
     return ready;
 }
 
 void led_process_functions() {
-    led_debug("led_process_functions");
-    led_debug("Process line prep (isinit: %d len: %d)", led_line_isinit(&led.line_prep), led_u8s_len(&led.line_prep.lstr));
-    if (led_line_isinit(&led.line_prep)) {
-        led_debug("prep line is init");
-        if (led_line_isselected(&led.line_prep)) {
-            led_debug("prep line is selected");
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_process_functions");
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "Process line prep (isinit: %d len: %d)", led_line_isinit(led.line_prep), led_u8s_len(&led.line_prep->lstr));
+    if (led_line_isinit(led.line_prep)) {
+        led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "prep line is init");
+        if (led_line_isselected(led.line_prep)) {
+            led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "prep line is selected");
+            led.report.line_match_count++;
+            led.report.file_line_match_count++;
             if (led.func_count > 0) {
                 for (size_t ifunc = 0; ifunc < led.func_count; ifunc++) {
                     led_fn_t* pfunc = &led.func_list[ifunc];
                     led_fn_desc_t* pfn_desc = led_fn_table_descriptor(pfunc->id);
-                    led.report.line_match_count++;
-                    led_debug("Process function %s", pfn_desc->long_name);
+                    led_trace(LED_TRACE_FUNC, LED_TRACE_STEP, "Process function %s", pfn_desc->long_name);
+                    size_t len_in = led_u8s_len(&led.line_prep->lstr);
+                    uint64_t start = led_stat_begin(LED_STAT_FUNC + ifunc);
                     (pfn_desc->impl)(pfunc);
-                    led_line_cpy(&led.line_prep, &led.line_write);
+                    led_stat_end(LED_STAT_FUNC + ifunc, start, len_in, led_line_isinit(led.line_write) ? led_u8s_len(&led.line_write->lstr) : 0);
+                    // the function result becomes the next function input
+                    led_line_swap(&led.line_prep, &led.line_write);
+                    led.line_prep->zone_start = 0;
+                    led.line_prep->zone_stop = led_u8s_len(&led.line_prep->lstr);
                 }
+                // the last result goes back to the write line
+                led_line_swap(&led.line_prep, &led.line_write);
             }
             else {
-                led_debug("No function copy (len: %d)", led_u8s_len(&led.line_prep.lstr));
-                led_line_cpy(&led.line_write, &led.line_prep);
+                led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "No function swap (len: %d)", led_u8s_len(&led.line_prep->lstr));
+                led_line_swap(&led.line_prep, &led.line_write);
             }
         }
         else if (!led.opt.output_selected) {
-            led_debug("Copy unselected to dest");
-            led_line_cpy(&led.line_write, &led.line_prep);
+            led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "Swap unselected to dest");
+            led_line_swap(&led.line_prep, &led.line_write);
+        }
+    }
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "Process result line write (len=%d)", led_u8s_len(&led.line_write->lstr));
+    led_line_reset(led.line_prep);
+}
+
+void led_process_lines() {
+    // functionless regex filters search the input blocks at once
+    if (led.grep.enabled) {
+        led_process_grep();
+        return;
+    }
+    bool isline = false;
+    do {
+        isline = led_process_read();
+        if (led_process_selector()) {
+            led_process_functions();
+            if (led.opt.exec)
+                led_process_exec();
+            else
+                led_process_write();
         }
+    } while(isline);
+    if (led.opt.exec)
+        led_exec_flush();
+}
+
+const char* LED_STAT_NAME[LED_STAT_FUNC] = { "read", "selector", "write", "exec" };
+
+static const char* led_stat_name(size_t istat) {
+    if (istat < LED_STAT_FUNC) return LED_STAT_NAME[istat];
+    return led_fn_table_descriptor(led.func_list[istat - LED_STAT_FUNC].id)->long_name;
+}
+
+static void led_report_json() {
+    fprintf(stderr, "{\"line_match_count\":%lu,\"file_in_count\":%lu,\"file_out_count\":%lu,\"file_match_count\":%lu,\"file_invalid_count\":%lu,"
+        "\"exec_count\":%lu,\"exec_fail_count\":%lu,\"regex_alloc_count\":%lu,\"stages\":[",
+        led.report.line_match_count, led.report.file_in_count, led.report.file_out_count, led.report.file_match_count, led.report.file_invalid_count,
+        led.report.exec_count, led.report.exec_fail_count, __atomic_load_n(&led_regex_alloc_count, __ATOMIC_RELAXED));
+    bool first = true;
+    for (size_t istat = 0; istat < LED_STAT_FUNC + led.func_count; istat++) {
+        led_stat_t* pstat = &led.report.stat[istat];
+        if (istat < LED_STAT_FUNC && pstat->count == 0) continue;
+        fprintf(stderr, "%s{\"stage\":\"%s\",", first ? "" : ",", istat < LED_STAT_FUNC ? led_stat_name(istat) : "function");
+        if (istat >= LED_STAT_FUNC)
+            fprintf(stderr, "\"function\":\"%s\",\"index\":%lu,", led_stat_name(istat), istat - LED_STAT_FUNC);
+        fprintf(stderr, "\"count\":%lu,\"time_ns\":%lu,\"bytes_in\":%lu,\"bytes_out\":%lu,\"match_count\":%lu,\"nomatch_count\":%lu,\"line_max\":%lu}",
+            pstat->count, pstat->time, pstat->bytes_in, pstat->bytes_out, pstat->match_count, pstat->nomatch_count, pstat->line_max);
+        first = false;
     }
-    led_debug("Process result line write (len=%d)", led_u8s_len(&led.line_write.lstr));
-    led_line_reset(&led.line_prep);
+    fprintf(stderr, "]}\n");
 }
 
 void led_report() {
+    if (led.opt.report_json) {
+        led_report_json();
+        return;
+    }
     fprintf(stderr, "\nLED report:\n");
     fprintf(stderr, "Line match count: %ld\n", led.report.line_match_count);
     fprintf(stderr, "\n");
     fprintf(stderr, "File input count: %ld\n", led.report.file_in_count);
     fprintf(stderr, "File output count: %ld\n", led.report.file_out_count);
     fprintf(stderr, "File match count: %ld\n", led.report.file_match_count);
+    fprintf(stderr, "File invalid count: %ld\n", led.report.file_invalid_count);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Exec count: %ld\n", led.report.exec_count);
+    fprintf(stderr, "Exec fail count: %ld\n", led.report.exec_fail_count);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Regex alloc count: %ld\n", __atomic_load_n(&led_regex_alloc_count, __ATOMIC_RELAXED));
+    fprintf(stderr, "\n");
+    // the time of the stages run by workers is summed
+    fprintf(stderr, "%-24s %10s %12s %14s %14s %10s %10s %10s\n",
+        "Stage", "Count", "Time (ms)", "Bytes in", "Bytes out", "Match", "No match", "Line max");
+    for (size_t istat = 0; istat < LED_STAT_FUNC + led.func_count; istat++) {
+        led_stat_t* pstat = &led.report.stat[istat];
+        if (istat < LED_STAT_FUNC && pstat->count == 0) continue;
+        char name[32];
+        if (istat < LED_STAT_FUNC)
+            snprintf(name, sizeof name, "%s", led_stat_name(istat));
+        else
+            snprintf(name, sizeof name, "%lu:%s", istat - LED_STAT_FUNC, led_stat_name(istat));
+        fprintf(stderr, "%-24s %10lu %12.3f %14lu %14lu %10lu %10lu %10lu\n",
+            name, pstat->count, pstat->time / 1e6, pstat->bytes_in, pstat->bytes_out, pstat->match_count, pstat->nomatch_count, pstat->line_max);
+    }
+}
+
+void led_report_merge(led_t* pctx) {
+    led.report.line_match_count += pctx->report.line_match_count;
+    led.report.file_in_count += pctx->report.file_in_count;
+    led.report.file_out_count += pctx->report.file_out_count;
+    led.report.file_match_count += pctx->report.file_match_count;
+    led.report.file_invalid_count += pctx->report.file_invalid_count;
+    for (size_t istat = 0; istat < LED_STAT_MAX; istat++) {
+        led_stat_t* pstat = &led.report.stat[istat];
+        led_stat_t* pstat_src = &pctx->report.stat[istat];
+        pstat->count += pstat_src->count;
+        pstat->time += pstat_src->time;
+        pstat->bytes_in += pstat_src->bytes_in;
+        pstat->bytes_out += pstat_src->bytes_out;
+        pstat->match_count += pstat_src->match_count;
+        pstat->nomatch_count += pstat_src->nomatch_count;
+        if (pstat_src->line_max > pstat->line_max) pstat->line_max = pstat_src->line_max;
+    }
 }
@@ -0,0 +1,304 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+
+#define _GNU_SOURCE
+#include "led.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+//-----------------------------------------------
+// LED command execution
+//-----------------------------------------------
+
+// a persistent shell ends each command output with this marker and the exit status
+#define LED_EXEC_MARK '\036'
+#define LED_EXEC_MARK_STR "\036LED"
+
+// args size limit of a batch when the system gives none or a bigger one
+#define LED_EXEC_ARG_MAX 0x200000
+
+static pid_t led_exec_spawn(char* const argv[], int* pfd, int* pfd_in) {
+    int fd_out[2];
+    int fd_in[2] = { -1, -1 };
+    led_assert(pipe2(fd_out, O_CLOEXEC) == 0, LED_ERR_EXEC, "Command pipe error: %s", strerror(errno));
+    if (pfd_in)
+        led_assert(pipe2(fd_in, O_CLOEXEC) == 0, LED_ERR_EXEC, "Command pipe error: %s", strerror(errno));
+
+    // commands do not read the led input
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (pfd_in)
+        posix_spawn_file_actions_adddup2(&actions, fd_in[0], STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fd_out[1], STDOUT_FILENO);
+
+    // the command is searched in the PATH as execvp does
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fd_out[1]);
+    if (pfd_in) close(fd_in[0]);
+    led_assert(rc == 0, LED_ERR_EXEC, "Command spawn error: %s: %s", argv[0], strerror(rc));
+
+    *pfd = fd_out[0];
+    if (pfd_in) *pfd_in = fd_in[1];
+    return pid;
+}
+
+static void led_exec_write(int fd, const char* str, size_t len) {
+    while (len > 0) {
+        ssize_t rc = write(fd, str, len);
+        if (rc < 0 && errno == EINTR) continue;
+        led_assert(rc >= 0, LED_ERR_EXEC, "Command write error: %s", strerror(errno));
+        str += rc;
+        len -= rc;
+    }
+}
+
+static int led_exec_status(int wstatus) {
+    return WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+}
+
+static void led_exec_close(led_exec_slot_t* pslot) {
+    if (pslot->fd_in >= 0) close(pslot->fd_in);
+    if (pslot->fd >= 0) close(pslot->fd);
+    pslot->fd_in = pslot->fd = -1;
+    int wstatus = 0;
+    if (pslot->pid > 0) {
+        while (waitpid(pslot->pid, &wstatus, 0) < 0 && errno == EINTR);
+        pslot->status = led_exec_status(wstatus);
+    }
+    pslot->pid = 0;
+}
+
+static void led_exec_done(led_exec_slot_t* pslot) {
+    pslot->running = false;
+    pslot->done = true;
+    led.report.exec_count++;
+    if (pslot->status != 0) led.report.exec_fail_count++;
+    led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Command %lu done: status %d", pslot->seq, pslot->status);
+}
+
+static void led_exec_output(led_exec_slot_t* pslot) {
+    led_writer_write(&led.file_out.writer, pslot->out.buf, pslot->out.len);
+    pslot->out.len = 0;
+    pslot->done = false;
+}
+
+static void led_exec_read(led_exec_slot_t* pslot) {
+    char buf[0x10000];
+    ssize_t rc;
+    do rc = read(pslot->fd, buf, sizeof buf);
+    while (rc < 0 && errno == EINTR);
+    led_assert(rc >= 0, LED_ERR_EXEC, "Command read error: %s", strerror(errno));
+
+    if (rc > 0) {
+        led_writer_write(&pslot->out, buf, rc);
+        if (pslot->fd_in < 0) return;
+        // the shell ends the command with the marker and its status
+        char* end = pslot->out.buf + pslot->out.len;
+        if (end[-1] != LED_EXEC_MARK) return;
+        char* mark = memrchr(pslot->out.buf, LED_EXEC_MARK, pslot->out.len - 1);
+        if (mark == NULL || strncmp(mark, LED_EXEC_MARK_STR, sizeof LED_EXEC_MARK_STR - 1) != 0) return;
+        pslot->status = atoi(mark + sizeof LED_EXEC_MARK_STR - 1);
+        pslot->out.len = mark - pslot->out.buf;
+    }
+    else
+        // end of the command, or of the shell that is spawned again on next command
+        led_exec_close(pslot);
+    led_exec_done(pslot);
+}
+
+static void led_exec_wait() {
+    struct pollfd pfds[led.exec.slot_count];
+    led_exec_slot_t* pslots[led.exec.slot_count];
+    nfds_t count = 0;
+    for (size_t i = 0; i < led.exec.slot_count; i++)
+        if (led.exec.slots[i].running) {
+            pfds[count].fd = led.exec.slots[i].fd;
+            pfds[count].events = POLLIN;
+            pslots[count++] = &led.exec.slots[i];
+        }
+    if (count == 0) return;
+
+    int rc = poll(pfds, count, -1);
+    led_assert(rc >= 0 || errno == EINTR, LED_ERR_EXEC, "Command poll error: %s", strerror(errno));
+    for (nfds_t i = 0; rc > 0 && i < count; i++)
+        if (pfds[i].revents)
+            led_exec_read(pslots[i]);
+
+    // outputs are written in submission order, or on completion with -jNc
+    bool next = true;
+    while (next) {
+        next = false;
+        for (size_t i = 0; i < led.exec.slot_count; i++) {
+            led_exec_slot_t* pslot = &led.exec.slots[i];
+            if (pslot->done && led.opt.jobs_unordered)
+                led_exec_output(pslot);
+            else if (pslot->done && pslot->seq == led.exec.seq_out) {
+                led_exec_output(pslot);
+                led.exec.seq_out++;
+                next = true;
+            }
+        }
+    }
+}
+
+static void led_exec_init() {
+    led.exec.slot_count = led.opt.jobs > 1 ? led.opt.jobs : 1;
+    led.exec.slots = calloc(led.exec.slot_count, sizeof *led.exec.slots);
+    led_assert(led.exec.slots != NULL, LED_ERR_INTERNAL, "Command slots allocation error");
+    for (size_t i = 0; i < led.exec.slot_count; i++) {
+        led.exec.slots[i].fd = led.exec.slots[i].fd_in = -1;
+        led_writer_open_mem(&led.exec.slots[i].out);
+    }
+    led.exec.seq_in = led.exec.seq_out = 0;
+
+    if (led.opt.exec_mode == LED_EXEC_BATCH) {
+        // the command words are split once, the batch args follow them
+        led.exec.cmd_buf = strdup(led_u8s_str(&led.opt.exec_cmd));
+        led.exec.cmd_argv = calloc(led_u8s_len(&led.opt.exec_cmd) / 2 + 2, sizeof *led.exec.cmd_argv);
+        led_assert(led.exec.cmd_buf != NULL && led.exec.cmd_argv != NULL, LED_ERR_INTERNAL, "Command allocation error");
+        char* save = NULL;
+        for (char* word = strtok_r(led.exec.cmd_buf, " \t", &save); word != NULL; word = strtok_r(NULL, " \t", &save))
+            led.exec.cmd_argv[led.exec.cmd_argc++] = word;
+        led_assert(led.exec.cmd_argc > 0, LED_ERR_ARG, "Missing batch command");
+
+        // the args and the environment share the system limit, as xargs a margin is kept
+        size_t size = 0;
+        for (char** env = environ; *env; env++)
+            size += strlen(*env) + 1 + sizeof *env;
+        for (size_t i = 0; i < led.exec.cmd_argc; i++)
+            size += strlen(led.exec.cmd_argv[i]) + 1 + sizeof *led.exec.cmd_argv;
+        long arg_max = sysconf(_SC_ARG_MAX);
+        if (arg_max <= 0 || arg_max > LED_EXEC_ARG_MAX) arg_max = LED_EXEC_ARG_MAX;
+        led_assert((size_t)arg_max > size + 0x800, LED_ERR_EXEC, "Batch command and environment exceed the args size limit");
+        led.exec.batch_size_max = arg_max - size - 0x800;
+        led_writer_open_mem(&led.exec.batch);
+        led_debug("Batch command: %s (%lu words, args size max %lu)", led_u8s_str(&led.opt.exec_cmd), led.exec.cmd_argc, led.exec.batch_size_max);
+    }
+}
+
+static led_exec_slot_t* led_exec_slot() {
+    if (led.exec.slots == NULL) led_exec_init();
+
+    led_exec_slot_t* pslot = NULL;
+    while (pslot == NULL) {
+        for (size_t i = 0; i < led.exec.slot_count && pslot == NULL; i++)
+            if (!led.exec.slots[i].running && !led.exec.slots[i].done)
+                pslot = &led.exec.slots[i];
+        if (pslot == NULL) led_exec_wait();
+    }
+    pslot->seq = led.exec.seq_in++;
+    pslot->status = 0;
+    pslot->running = true;
+    return pslot;
+}
+
+void led_exec_submit(const char* cmd) {
+    led_exec_slot_t* pslot = led_exec_slot();
+    led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Command %lu: %s", pslot->seq, cmd);
+
+    if (led.opt.exec_mode == LED_EXEC_SHELL) {
+        if (pslot->pid == 0) {
+            char* argv[] = { "/bin/sh", NULL };
+            pslot->pid = led_exec_spawn(argv, &pslot->fd, &pslot->fd_in);
+        }
+        // the command is evaluated in a sub shell, a syntax error, its state and input stay local
+        const char* mark = "' ) </dev/null; printf '" LED_EXEC_MARK_STR "%d\\036' $?\n";
+        led_exec_write(pslot->fd_in, "( eval '", 8);
+        for (const char* quote; (quote = strchr(cmd, '\'')) != NULL; cmd = quote + 1) {
+            led_exec_write(pslot->fd_in, cmd, quote - cmd);
+            led_exec_write(pslot->fd_in, "'\\''", 4);
+        }
+        led_exec_write(pslot->fd_in, cmd, strlen(cmd));
+        led_exec_write(pslot->fd_in, mark, strlen(mark));
+    }
+    else {
+        char* argv[] = { "/bin/sh", "-c", (char*)cmd, NULL };
+        pslot->pid = led_exec_spawn(argv, &pslot->fd, NULL);
+    }
+}
+
+static void led_exec_batch_run() {
+    if (led.exec.batch_count == 0) return;
+
+    char** argv = malloc((led.exec.cmd_argc + led.exec.batch_count + 1) * sizeof *argv);
+    led_assert(argv != NULL, LED_ERR_INTERNAL, "Command allocation error");
+    memcpy(argv, led.exec.cmd_argv, led.exec.cmd_argc * sizeof *argv);
+    char* arg = led.exec.batch.buf;
+    for (size_t i = 0; i < led.exec.batch_count; i++, arg += strlen(arg) + 1)
+        argv[led.exec.cmd_argc + i] = arg;
+    argv[led.exec.cmd_argc + led.exec.batch_count] = NULL;
+
+    led_exec_slot_t* pslot = led_exec_slot();
+    led_trace(LED_TRACE_IO, LED_TRACE_STEP, "Command %lu: %s with %lu args", pslot->seq, argv[0], led.exec.batch_count);
+    pslot->pid = led_exec_spawn(argv, &pslot->fd, NULL);
+    free(argv);
+
+    led.exec.batch.len = 0;
+    led.exec.batch_count = 0;
+    led.exec.batch_size = 0;
+}
+
+void led_exec_batch(const char* arg, size_t len) {
+    if (led.exec.slots == NULL) led_exec_init();
+
+    size_t size = len + 1 + sizeof(char*);
+    if (led.exec.batch_count > 0
+        && (led.exec.batch_size + size > led.exec.batch_size_max
+            || (led.opt.exec_batch_max && led.exec.batch_count >= led.opt.exec_batch_max)))
+        led_exec_batch_run();
+    led_writer_write(&led.exec.batch, arg, len);
+    led_writer_write(&led.exec.batch, "", 1);
+    led.exec.batch_count++;
+    led.exec.batch_size += size;
+}
+
+void led_exec_flush() {
+    led_exec_batch_run();
+    for (;;) {
+        bool pending = false;
+        for (size_t i = 0; i < led.exec.slot_count; i++)
+            pending = pending || led.exec.slots[i].running || led.exec.slots[i].done;
+        if (!pending) break;
+        led_exec_wait();
+    }
+}
+
+void led_exec_free() {
+    for (size_t i = 0; i < led.exec.slot_count; i++) {
+        led_exec_close(&led.exec.slots[i]);
+        led_writer_free(&led.exec.slots[i].out);
+    }
+    free(led.exec.slots);
+    free(led.exec.cmd_argv);
+    free(led.exec.cmd_buf);
+    led_writer_free(&led.exec.batch);
+    memset(&led.exec, 0, sizeof led.exec);
+    led.exec.batch.fd = -1;
+}
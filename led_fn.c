@@ -19,8 +19,7 @@
 
 #include "led.h"
 
-#include <b64/cencode.h>
-#include <b64/cdecode.h>
+#include <pthread.h>
 
 //-----------------------------------------------
 // LED functions utilities
@@ -28,21 +27,77 @@
 
 #define countof(a) (sizeof(a)/sizeof(a[0]))
 
+// the fixed separator sets, compiled once and shared by all the contexts
+static led_charset_t led_fn_seps_csv;
+static led_charset_t led_fn_seps_space;
+static led_charset_t led_fn_seps_mixed;
+static led_charset_t led_fn_seps_tab;
+static pthread_once_t led_fn_seps_once = PTHREAD_ONCE_INIT;
+
+static void led_fn_seps_init() {
+    led_u8s_decl_str(csv, ",;");
+    led_u8s_decl_str(space, " \t\n");
+    led_u8s_decl_str(mixed, ",; \t\n");
+    led_u8s_decl_str(tab, "\t");
+    led_charset_init(&led_fn_seps_csv, &csv);
+    led_charset_init(&led_fn_seps_space, &space);
+    led_charset_init(&led_fn_seps_mixed, &mixed);
+    led_charset_init(&led_fn_seps_tab, &tab);
+}
+
+// the escape schemes, compiled once and shared by all the contexts
+static led_esc_t led_fn_esc_url;
+static led_esc_t led_fn_esc_shell;
+static led_esc_t led_fn_esc_c;
+static led_esc_t led_fn_esc_json;
+static pthread_once_t led_fn_esc_once = PTHREAD_ONCE_INIT;
+
+static void led_fn_esc_init() {
+    static const char SHELL_SAFE[] = "/._-~:=%";
+    static const char C_CTRL[] = "\aa\bb\ff\nn\rr\tt\vv";
+    for (size_t c = 0; c < 256; c++) {
+        bool isalnum = c < 0x80 && led_u8c_isalnum(c);
+        bool isctrl = c < 0x20 || c == 0x7F;
+        // url: only the ASCII letters and digits are kept, UTF-8 chars are encoded by bytes
+        led_fn_esc_url.byte[c] = isalnum ? LED_ESC_NONE : LED_ESC_PCT;
+        // shell: the non ASCII chars are kept
+        led_fn_esc_shell.byte[c] = isalnum || c >= 0x80 || (c != 0 && strchr(SHELL_SAFE, c)) ? LED_ESC_NONE : LED_ESC_BSL;
+        led_fn_esc_c.byte[c] = isctrl ? LED_ESC_OCT : LED_ESC_NONE;
+        led_fn_esc_json.byte[c] = c < 0x20 ? LED_ESC_U4 : LED_ESC_NONE;
+    }
+    for (size_t i = 0; C_CTRL[i]; i += 2) {
+        led_fn_esc_c.byte[(uint8_t)C_CTRL[i]] = C_CTRL[i + 1];
+        if (C_CTRL[i] != '\a' && C_CTRL[i] != '\v')
+            led_fn_esc_json.byte[(uint8_t)C_CTRL[i]] = C_CTRL[i + 1];
+    }
+    led_fn_esc_c.byte['\\'] = led_fn_esc_json.byte['\\'] = LED_ESC_BSL;
+    led_fn_esc_c.byte['"'] = led_fn_esc_json.byte['"'] = LED_ESC_BSL;
+    led_esc_init(&led_fn_esc_url);
+    led_esc_init(&led_fn_esc_shell);
+    led_esc_init(&led_fn_esc_c);
+    led_esc_init(&led_fn_esc_json);
+}
+
+void led_fn_config() {
+    pthread_once(&led_fn_seps_once, &led_fn_seps_init);
+    pthread_once(&led_fn_esc_once, &led_fn_esc_init);
+}
+
 bool led_zone_pre_process(led_fn_t* pfunc) {
-    led_line_init(&led.line_write);
+    led_line_init(led.line_write);
 
-    led.line_prep.zone_start = led.line_prep.zone_stop = led_u8s_len(&led.line_prep.lstr);
-    bool rc = led_u8s_match_offset(&led.line_prep.lstr, pfunc->regex, &led.line_prep.zone_start, &led.line_prep.zone_stop);
+    led.line_prep->zone_start = led.line_prep->zone_stop = led_u8s_len(&led.line_prep->lstr);
+    bool rc = led_u8s_match_offset(&led.line_prep->lstr, pfunc->regex, &led.line_prep->zone_start, &led.line_prep->zone_stop);
 
     if (!led.opt.output_match)
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, 0, led.line_prep.zone_start);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, 0, led.line_prep->zone_start);
 
     return rc;
 }
 
 void led_zone_post_process() {
     if (!led.opt.output_match)
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_stop, led.line_prep.lstr.len);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_stop, led.line_prep->lstr.len);
 }
 
 //-----------------------------------------------
@@ -51,12 +106,11 @@ void led_zone_post_process() {
 
 void led_fn_impl_register(led_fn_t* pfunc) {
     // register is a passtrough function, line stays unchanged
-    led_line_cpy(&led.line_write, &led.line_prep);
+    led_line_cpy(led.line_write, led.line_prep);
 
-    pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(pfunc->regex, NULL);
-    int rc = pcre2_match(pfunc->regex, (PCRE2_SPTR)led_u8s_str(&led.line_prep.lstr), led_u8s_len(&led.line_prep.lstr), 0, 0, match_data, NULL);
-    PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
-    led_debug("match_count %d ", rc);
+    int rc = led_regex_match(pfunc->regex, led_u8s_str(&led.line_prep->lstr), led_u8s_len(&led.line_prep->lstr));
+    PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(led_regex_match_data(pfunc->regex));
+    led_trace(LED_TRACE_REGEX, LED_TRACE_STEP, "match_count %d ", rc);
 
     if (pfunc->arg_count > 0) {
         // usecase with fixed register ID argument
@@ -64,23 +118,22 @@ void led_fn_impl_register(led_fn_t* pfunc) {
         led_assert(ir < LED_REG_MAX, LED_ERR_ARG, "Register ID %lu exeed maximum register ID %d", ir, LED_REG_MAX-1);
         if( rc > 0) {
             int iv = (rc - 1) * 2;
-            led_debug("match_offset values %d %d", ovector[iv], ovector[iv+1]);
+            led_trace(LED_TRACE_REGEX, LED_TRACE_DETAIL, "match_offset values %d %d", ovector[iv], ovector[iv+1]);
             led_line_init(&led.line_reg[ir]);
-            led_u8s_app_zn(&led.line_reg[ir].lstr, &led.line_prep.lstr, ovector[iv], ovector[iv+1]);
-            led_debug("register value %d (%s)", ir, led_u8s_str(&led.line_reg[ir].lstr));
+            led_u8s_app_zn(&led.line_reg[ir].lstr, &led.line_prep->lstr, ovector[iv], ovector[iv+1]);
+            led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "register value %d (%s)", ir, led_u8s_str(&led.line_reg[ir].lstr));
         }
     }
     else {
         // usecase with unfixed register ID, catch all groups and distribute into registers, R0 is the global matching zone
         for (int ir = 0; ir < rc && ir < LED_REG_MAX; ir++) {
             int iv = ir * 2;
-            led_debug("match_offset values %d %d", ovector[iv], ovector[iv+1]);
+            led_trace(LED_TRACE_REGEX, LED_TRACE_DETAIL, "match_offset values %d %d", ovector[iv], ovector[iv+1]);
             led_line_init(&led.line_reg[ir]);
-            led_u8s_app_zn(&led.line_reg[ir].lstr, &led.line_prep.lstr, ovector[iv], ovector[iv+1]);
-            led_debug("register value %d (%s)", ir, led_u8s_str(&led.line_reg[ir].lstr));
+            led_u8s_app_zn(&led.line_reg[ir].lstr, &led.line_prep->lstr, ovector[iv], ovector[iv+1]);
+            led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "register value %d (%s)", ir, led_u8s_str(&led.line_reg[ir].lstr));
         }
     }
-    pcre2_match_data_free(match_data);
 }
 
 void led_fn_impl_register_recall(led_fn_t* pfunc) {
@@ -90,235 +143,367 @@ void led_fn_impl_register_recall(led_fn_t* pfunc) {
     if (led_line_isinit(&led.line_reg[ir])) {
         led.line_reg[ir].zone_start = led.line_reg[ir].zone_stop = led_u8s_len(&led.line_reg[ir].lstr);
         led_u8s_match_offset(&led.line_reg[ir].lstr, pfunc->regex, &led.line_reg[ir].zone_start, &led.line_reg[ir].zone_stop);
-        led_line_init(&led.line_write);
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_reg[ir].lstr, led.line_reg[ir].zone_start, led.line_reg[ir].zone_stop);
+        led_line_init(led.line_write);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_reg[ir].lstr, led.line_reg[ir].zone_start, led.line_reg[ir].zone_stop);
     }
     else {
         // no change to current line if register is not init
-        led_line_cpy(&led.line_write, &led.line_prep);
+        led_line_cpy(led.line_write, led.line_prep);
     }
 }
 
 void led_fn_helper_substitute(led_fn_t* pfunc, led_u8s_t* sinput, led_u8s_t* soutput) {
-    led_u8s_decl(sreplace, LED_BUF_MAX);
-    led_debug("led_fn_helper_substitute: Replace registers in substitute string (len=%d) %s", led_u8s_len(&pfunc->arg[0].lstr), led_u8s_str(&pfunc->arg[0].lstr));
-
-    size_t i = 0;
-    while ( i < led_u8s_len(&pfunc->arg[0].lstr) ) {
-        if (led_u8s_isfull(&sreplace)) break;
-        if (led_u8s_startswith_str_at(&pfunc->arg[0].lstr, "$R", i)) {
-            size_t ir = 0;
-            size_t in = i+2; // position of of register ID if given.
-            if ( in < led_u8s_len(&pfunc->arg[0].lstr) && led_u8c_isdigit(led_u8s_char_at(&pfunc->arg[0].lstr, in)) ) {
-                ir = led_u8s_char_at(&pfunc->arg[0].lstr, in++) - '0';
-            }
-            led_debug("led_fn_helper_substitute: Replace register %d found at %d", ir, i);
-            size_t j = 0;
-            while (j < led_u8s_len(&led.line_reg[ir].lstr)) {
-                u8c_t c = led_u8s_char_next(&led.line_reg[ir].lstr, &j);
-                if (c == '\\') // double anti slash to make it a true character
-                    led_u8s_app_char(&sreplace, c);
-                led_u8s_app_char(&sreplace, c);
+    // a template without register is given as is, otherwise it is spliced with the registers
+    led_u8s_t sreplace = pfunc->arg[0].lstr;
+    if (pfunc->tmpl.hasreg) {
+        led_u8s_clone(&sreplace, &led_line_init(&led.line_subst)->lstr);
+        sreplace.pbuf = &led.line_subst.buf;
+        for (size_t iseg = 0; iseg < pfunc->tmpl.seg_count; iseg++) {
+            led_tmpl_seg_t* pseg = &pfunc->tmpl.seg[iseg];
+            if (pseg->reg < 0) {
+                led_u8s_app_zn(&sreplace, &pfunc->arg[0].lstr, pseg->start, pseg->stop);
+                continue;
             }
-            i = in; // position "i" at end of register mark
+            led_u8s_t* preg = &led.line_reg[pseg->reg].lstr;
+            led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_fn_helper_substitute: Replace register %d", pseg->reg);
+            // double anti slash to make it a true character
+            const char* str = preg->str;
+            const char* stop = preg->str + preg->len;
+            for (const char* bs; str < stop && (bs = memchr(str, '\\', stop - str)) != NULL; str = bs + 1)
+                led_u8s_app_char(led_u8s_app_buf(&sreplace, str, bs - str + 1), '\\');
+            led_u8s_app_buf(&sreplace, str, stop - str);
         }
-        else {
-            u8c_t c = led_u8s_char_next(&pfunc->arg[0].lstr, &i);
-            led_debug("led_fn_helper_substitute: append to sreplace %c", c);
-            led_u8s_app_char(&sreplace, c);
-        }
-    }
-
-    //TODO: must be optimized, should be done at initialization
-    uint32_t opts = 0;
-    if (pfunc->arg_count > 1) {
-        size_t i = 0;
-        while (i < led_u8s_len(&pfunc->arg[1].lstr))
-            switch (led_u8s_char_next(&pfunc->arg[1].lstr, &i)) {
-                case 'g':
-                    opts |= PCRE2_SUBSTITUTE_GLOBAL;
-                    break;
-                case 'e':
-                    opts |= PCRE2_SUBSTITUTE_EXTENDED;
-                    break;
-                case 'l':
-                    opts |= PCRE2_SUBSTITUTE_LITERAL;
-                    break;
-                default:
-                    break;
-            }
     }
-
-    led_debug("Substitute input line (len=%d) to sreplace (len=%d)", led_u8s_len(sinput), led_u8s_len(&sreplace));
-    PCRE2_SIZE len = led_u8s_size(soutput);
-    int rc = pcre2_substitute(
-                pfunc->regex,
+    uint32_t opts = pfunc->tmpl.opts;
+
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "Substitute input line (len=%d) to sreplace (len=%d)", led_u8s_len(sinput), led_u8s_len(&sreplace));
+    // the output is given the needed length to grow when it is too small
+    opts |= PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
+    if (led.opt.regex_nojit) opts |= PCRE2_NO_JIT;
+    int rc;
+    PCRE2_SIZE len;
+    for (;;) {
+        len = led_u8s_size(soutput);
+        rc = pcre2_substitute(
+                pfunc->regex->code,
                 (PCRE2_UCHAR8*)led_u8s_str(sinput),
                 led_u8s_len(sinput),
                 0,
                 opts,
-                NULL,
-                NULL,
+                led_regex_match_data(pfunc->regex),
+                led.regex.mctx,
                 (PCRE2_UCHAR8*)led_u8s_str(&sreplace),
                 led_u8s_len(&sreplace),
                 (PCRE2_UCHAR8*)led_u8s_str(soutput),
                 &len);
+        if (rc == PCRE2_ERROR_JIT_STACKLIMIT && !(opts & PCRE2_NO_JIT)) {
+            // the interpreter has no JIT stack limit
+            led_trace(LED_TRACE_REGEX, LED_TRACE_STEP, "Regex JIT stack limit reached, interpreted");
+            opts |= PCRE2_NO_JIT;
+        }
+        else if (rc == PCRE2_ERROR_NOMEMORY && soutput->pbuf != NULL)
+            led_u8s_grow(soutput, len);
+        else
+            break;
+    }
     led_assert_pcre(rc);
     soutput->len = len;
+    // rc is the substitution count
+    if (led.report.pstat != NULL) {
+        if (rc > 0) led.report.pstat->match_count++;
+        else led.report.pstat->nomatch_count++;
+    }
 }
 
 void led_fn_impl_substitute(led_fn_t* pfunc) {
-    led_fn_helper_substitute(pfunc, &led.line_prep.lstr, led_u8s_init_buf(&led.line_write.lstr,led.line_write.buf));
+    led_fn_helper_substitute(pfunc, &led.line_prep->lstr, &led_line_init(led.line_write)->lstr);
 }
 
 void led_fn_impl_delete(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    if (led.line_prep.zone_start == 0 && led.line_prep.zone_stop == led_u8s_len(&led.line_prep.lstr))
+    if (led.line_prep->zone_start == 0 && led.line_prep->zone_stop == led_u8s_len(&led.line_prep->lstr))
         // delete all the line if it all match
-        led_line_reset(&led.line_write);
+        led_line_reset(led.line_write);
     else
         // only remove matching zone
         led_zone_post_process();
 }
 
 void led_fn_impl_delete_blank(led_fn_t*) {
-    if (led_u8s_isempty(&led.line_prep.lstr) || led_u8s_isblank(&led.line_prep.lstr))
-        led_line_reset(&led.line_write);
+    if (led_u8s_isempty(&led.line_prep->lstr) || led_u8s_isblank(&led.line_prep->lstr))
+        led_line_reset(led.line_write);
     else
-        led_u8s_cpy(&led.line_write.lstr, &led.line_prep.lstr);
+        led_line_cpy(led.line_write, led.line_prep);
 }
 
 void led_fn_impl_insert(led_fn_t* pfunc) {
-    led_u8s_decl(newline, LED_BUF_MAX);
-    led_fn_helper_substitute(pfunc, &led.line_prep.lstr, &newline);
+    led_u8s_t* newline = &led_line_init(&led.line_tmp)->lstr;
+    led_fn_helper_substitute(pfunc, &led.line_prep->lstr, newline);
 
-    led_u8s_init_buf(&led.line_write.lstr, led.line_write.buf);
-    led_u8s_empty(&led.line_write.lstr);
+    led_line_init(led.line_write);
     size_t lcount = pfunc->arg_count > 1 ? pfunc->arg[1].uval : 1;
     for (size_t i = 0; i < lcount; i++) {
-        led_u8s_app(&led.line_write.lstr, &newline);
-        led_u8s_app_char(&led.line_write.lstr, '\n');
+        led_u8s_app(&led.line_write->lstr, newline);
+        led_u8s_app_char(&led.line_write->lstr, '\n');
     }
-    led_u8s_app(&led.line_write.lstr, &led.line_prep.lstr);
+    led_u8s_app(&led.line_write->lstr, &led.line_prep->lstr);
 }
 
 void led_fn_impl_append(led_fn_t* pfunc) {
-    led_u8s_decl(newline, LED_BUF_MAX);
-    led_fn_helper_substitute(pfunc, &led.line_prep.lstr, &newline);
+    led_u8s_t* newline = &led_line_init(&led.line_tmp)->lstr;
+    led_fn_helper_substitute(pfunc, &led.line_prep->lstr, newline);
 
-    led_u8s_init_buf(&led.line_write.lstr,led.line_write.buf);
-    led_u8s_cpy(&led.line_write.lstr, &led.line_prep.lstr);
+    led_line_cpy(led.line_write, led.line_prep);
     size_t lcount = pfunc->arg_count > 1 ? pfunc->arg[1].uval : 1;
     for (size_t i = 0; i < lcount; i++) {
-        led_u8s_app_char(&led.line_write.lstr, '\n');
-        led_u8s_app(&led.line_write.lstr, &newline);;
+        led_u8s_app_char(&led.line_write->lstr, '\n');
+        led_u8s_app(&led.line_write->lstr, newline);
     }
 }
 
 void led_fn_impl_range_sel(led_fn_t* pfunc) {
-    led_line_init(&led.line_write);
+    led_line_init(led.line_write);
 
     if (led_u8s_iscontent(&pfunc->arg[0].lstr)) {
         long val = pfunc->arg[0].val;
         size_t uval = pfunc->arg[0].uval;
         if (val >= 0)
-            for (led.line_prep.zone_start = 0; led.line_prep.zone_start < led_u8s_len(&led.line_prep.lstr) && uval > 0; uval-- )
-                led_u8s_char_next(&led.line_prep.lstr, &led.line_prep.zone_start);
+            for (led.line_prep->zone_start = 0; led.line_prep->zone_start < led_u8s_len(&led.line_prep->lstr) && uval > 0; uval-- )
+                led_u8s_char_next(&led.line_prep->lstr, &led.line_prep->zone_start);
         else
-            for (led.line_prep.zone_start = led_u8s_len(&led.line_prep.lstr); led.line_prep.zone_start > 0 && uval > 0; uval-- )
-                led_u8s_char_prev(&led.line_prep.lstr, &led.line_prep.zone_start);
+            for (led.line_prep->zone_start = led_u8s_len(&led.line_prep->lstr); led.line_prep->zone_start > 0 && uval > 0; uval-- )
+                led_u8s_char_prev(&led.line_prep->lstr, &led.line_prep->zone_start);
     }
     if (led_u8s_iscontent(&pfunc->arg[1].lstr)) {
         size_t uval = pfunc->arg[1].uval;
-        for (led.line_prep.zone_stop = led.line_prep.zone_start; led.line_prep.zone_stop < led_u8s_len(&led.line_prep.lstr) && uval > 0; uval-- )
-            led_u8s_char_next(&led.line_prep.lstr, &led.line_prep.zone_stop);
+        for (led.line_prep->zone_stop = led.line_prep->zone_start; led.line_prep->zone_stop < led_u8s_len(&led.line_prep->lstr) && uval > 0; uval-- )
+            led_u8s_char_next(&led.line_prep->lstr, &led.line_prep->zone_stop);
     }
     else
-        led.line_prep.zone_stop = led_u8s_len(&led.line_prep.lstr);
+        led.line_prep->zone_stop = led_u8s_len(&led.line_prep->lstr);
 
-    led_line_append_zone(&led.line_write, &led.line_prep);
+    led_line_append_zone(led.line_write, led.line_prep);
 }
 
 void led_fn_impl_range_unsel(led_fn_t* pfunc) {
-    led_line_init(&led.line_write);
+    led_line_init(led.line_write);
 
     if (led_u8s_iscontent(&pfunc->arg[0].lstr)) {
         long val = pfunc->arg[0].val;
         size_t uval = pfunc->arg[0].uval;
         if (val >= 0)
-            for (led.line_prep.zone_start = 0; led.line_prep.zone_start < led_u8s_len(&led.line_prep.lstr) && uval > 0; uval-- )
-                led_u8s_char_next(&led.line_prep.lstr, &led.line_prep.zone_start);
+            for (led.line_prep->zone_start = 0; led.line_prep->zone_start < led_u8s_len(&led.line_prep->lstr) && uval > 0; uval-- )
+                led_u8s_char_next(&led.line_prep->lstr, &led.line_prep->zone_start);
         else
-            for (led.line_prep.zone_start = led_u8s_len(&led.line_prep.lstr); led.line_prep.zone_start > 0 && uval > 0; uval-- )
-                led_u8s_char_prev(&led.line_prep.lstr, &led.line_prep.zone_start);
+            for (led.line_prep->zone_start = led_u8s_len(&led.line_prep->lstr); led.line_prep->zone_start > 0 && uval > 0; uval-- )
+                led_u8s_char_prev(&led.line_prep->lstr, &led.line_prep->zone_start);
     }
     if (led_u8s_iscontent(&pfunc->arg[1].lstr)) {
         size_t uval = pfunc->arg[1].uval;
-        for (led.line_prep.zone_stop = led.line_prep.zone_start; led.line_prep.zone_stop < led_u8s_len(&led.line_prep.lstr) && uval > 0; uval-- )
-            led_u8s_char_next(&led.line_prep.lstr, &led.line_prep.zone_stop);
+        for (led.line_prep->zone_stop = led.line_prep->zone_start; led.line_prep->zone_stop < led_u8s_len(&led.line_prep->lstr) && uval > 0; uval-- )
+            led_u8s_char_next(&led.line_prep->lstr, &led.line_prep->zone_stop);
     }
     else
-        led.line_prep.zone_stop = led_u8s_len(&led.line_prep.lstr);
+        led.line_prep->zone_stop = led_u8s_len(&led.line_prep->lstr);
 
-    led_line_append_before_zone(&led.line_write, &led.line_prep);
-    led_line_append_after_zone(&led.line_write, &led.line_prep);
+    led_line_append_before_zone(led.line_write, led.line_prep);
+    led_line_append_after_zone(led.line_write, led.line_prep);
+}
+
+static u8c_t led_fn_tr_char_next(led_u8s_t* lset, size_t* pi) {
+    // a backslash escapes the next char: \- is a literal '-', \\ a backslash
+    u8c_t c = led_u8s_char_next(lset, pi);
+    if (c == '\\' && *pi < led_u8s_len(lset)) c = led_u8s_char_next(lset, pi);
+    return c;
+}
+
+// expand the chars of a set with the ranges (a-z), a '-' at the set start or end or escaped is literal
+static size_t led_fn_tr_expand(led_u8s_t* lset, u8c_t** pchars) {
+    size_t count = 0;
+    size_t size = 0;
+    u8c_t* chars = NULL;
+    size_t i = 0;
+    while (i < led_u8s_len(lset)) {
+        u8c_t first = led_fn_tr_char_next(lset, &i);
+        uint32_t code = led_u8c_decode(first);
+        uint32_t last = code;
+        if (i + 1 < led_u8s_len(lset) && led_u8s_char_at(lset, i) == '-') {
+            i++;
+            last = led_u8c_decode(led_fn_tr_char_next(lset, &i));
+            led_assert(last >= code, LED_ERR_ARG, "translate: bad chars range %s", led_u8s_str(lset));
+        }
+        for (; code <= last; code++) {
+            if (count == size) {
+                size = size ? size * 2 : 64;
+                chars = realloc(chars, size * sizeof *chars);
+                led_assert(chars != NULL, LED_ERR_INTERNAL, "Translate map allocation error");
+            }
+            chars[count++] = led_u8c_encode(code);
+        }
+    }
+    *pchars = chars;
+    return count;
+}
+
+static int led_fn_tr_pair_cmp(const void* a, const void* b) {
+    u8c_t ca = ((const led_tr_pair_t*)a)->src;
+    u8c_t cb = ((const led_tr_pair_t*)b)->src;
+    return ca < cb ? -1 : ca > cb;
+}
+
+static int led_fn_tr_key_cmp(const void* a, const void* b) {
+    uint64_t ka = *(const uint64_t*)a;
+    uint64_t kb = *(const uint64_t*)b;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static int led_fn_tr_char_cmp(const void* a, const void* b) {
+    u8c_t ca = *(const u8c_t*)a;
+    u8c_t cb = *(const u8c_t*)b;
+    return ca < cb ? -1 : ca > cb;
+}
+
+void led_fn_init_translate(led_fn_t* pfunc, size_t iarg) {
+    // tr/[regex]/src/dst[/opts]: d deletes the src chars, s squeezes the repeated chars of the last set
+    bool isdelete = false;
+    if (iarg + 2 < LED_FARG_MAX && led_u8s_isinit(&pfunc->arg[iarg + 2].lstr)) {
+        led_u8s_t* lopts = &pfunc->arg[iarg + 2].lstr;
+        for (size_t i = 0; i < led_u8s_len(lopts); i++) {
+            char opt = led_u8s_char_at(lopts, i);
+            led_assert(opt == 'd' || opt == 's', LED_ERR_ARG, "translate: bad option %c", opt);
+            if (opt == 'd') isdelete = true;
+            else pfunc->tr.squeeze = true;
+        }
+    }
+    u8c_t* src = NULL;
+    u8c_t* dst = NULL;
+    size_t src_count = led_fn_tr_expand(&pfunc->arg[iarg].lstr, &src);
+    size_t dst_count = led_u8s_isinit(&pfunc->arg[iarg + 1].lstr) ? led_fn_tr_expand(&pfunc->arg[iarg + 1].lstr, &dst) : 0;
+    led_assert(isdelete || pfunc->tr.squeeze || dst_count > 0, LED_ERR_ARG, "translate: missing target chars");
+
+    for (size_t c = 0; c < 256; c++)
+        pfunc->tr.byte[c] = c;
+    // without delete, the src chars beyond the dst ones are kept
+    size_t map_count = isdelete ? src_count : (src_count < dst_count ? src_count : dst_count);
+    // multibyte src chars sorted with their position: the first occurrence wins
+    uint64_t* keys = malloc((map_count + 1) * sizeof *keys);
+    pfunc->tr.mb = malloc((map_count + 1) * sizeof *pfunc->tr.mb);
+    led_assert(keys != NULL && pfunc->tr.mb != NULL, LED_ERR_INTERNAL, "Translate map allocation error");
+    size_t key_count = 0;
+    for (size_t i = map_count; i-- > 0; ) {
+        u8c_t target = isdelete ? LED_TR_DELETE : dst[i];
+        if (src[i] < 0x100)
+            pfunc->tr.byte[src[i]] = target;
+        else
+            keys[key_count++] = (uint64_t)src[i] << 32 | i;
+    }
+    qsort(keys, key_count, sizeof *keys, &led_fn_tr_key_cmp);
+    pfunc->tr.mb_count = 0;
+    for (size_t k = 0; k < key_count; k++) {
+        u8c_t c = keys[k] >> 32;
+        size_t i = keys[k] & 0xFFFFFFFF;
+        if (pfunc->tr.mb_count == 0 || pfunc->tr.mb[pfunc->tr.mb_count - 1].src != c)
+            pfunc->tr.mb[pfunc->tr.mb_count++] = (led_tr_pair_t){ c, isdelete ? LED_TR_DELETE : dst[i] };
+    }
+    free(keys);
+
+    if (pfunc->tr.squeeze) {
+        u8c_t* set = isdelete ? dst : (dst_count ? dst : src);
+        size_t set_count = isdelete ? dst_count : (dst_count ? dst_count : src_count);
+        pfunc->tr.squeeze_mb = malloc((set_count + 1) * sizeof *pfunc->tr.squeeze_mb);
+        led_assert(pfunc->tr.squeeze_mb != NULL, LED_ERR_INTERNAL, "Translate map allocation error");
+        for (size_t i = 0; i < set_count; i++) {
+            if (set[i] < 0x100) pfunc->tr.squeeze_byte[set[i] >> 3] |= 1 << (set[i] & 7);
+            else pfunc->tr.squeeze_mb[pfunc->tr.squeeze_mb_count++] = set[i];
+        }
+        qsort(pfunc->tr.squeeze_mb, pfunc->tr.squeeze_mb_count, sizeof *pfunc->tr.squeeze_mb, &led_fn_tr_char_cmp);
+    }
+
+    // pure ASCII map: byte table for the vector lookup
+    pfunc->tr.ascii = !isdelete && !pfunc->tr.squeeze && pfunc->tr.mb_count == 0;
+    for (size_t c = 0; c < 128 && pfunc->tr.ascii; c++) {
+        pfunc->tr.ascii = pfunc->tr.byte[c] < 0x80;
+        pfunc->tr.ascii_map[c] = pfunc->tr.byte[c];
+        if (pfunc->tr.byte[c] != c) pfunc->tr.ascii_blocks |= 1 << (c >> 4);
+    }
+    led_debug("function arg %i: translate map %lu chars (multibyte: %lu, ascii: %d, delete: %d, squeeze: %d)",
+        iarg+1, map_count, pfunc->tr.mb_count, pfunc->tr.ascii, isdelete, pfunc->tr.squeeze);
+    free(src);
+    free(dst);
+}
+
+void led_fn_free(led_fn_t* pfunc) {
+    led_charset_free(&pfunc->sep);
+    free(pfunc->tr.mb);
+    pfunc->tr.mb = NULL;
+    free(pfunc->tr.squeeze_mb);
+    pfunc->tr.squeeze_mb = NULL;
+}
+
+static u8c_t led_fn_tr_map(led_fn_t* pfunc, u8c_t c) {
+    if (c < 0x100) return pfunc->tr.byte[c];
+    led_tr_pair_t key = { c, 0 };
+    led_tr_pair_t* pair = bsearch(&key, pfunc->tr.mb, pfunc->tr.mb_count, sizeof key, &led_fn_tr_pair_cmp);
+    return pair != NULL ? pair->dst : c;
+}
+
+static bool led_fn_tr_issqueezed(led_fn_t* pfunc, u8c_t c) {
+    if (c < 0x100) return pfunc->tr.squeeze_byte[c >> 3] & (1 << (c & 7));
+    return bsearch(&c, pfunc->tr.squeeze_mb, pfunc->tr.squeeze_mb_count, sizeof c, &led_fn_tr_char_cmp) != NULL;
 }
 
 void led_fn_impl_translate(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        size_t j=0,k=0;
-        bool sub = false;
-        while ( j < led_u8s_len(&pfunc->arg[0].lstr) && k < led_u8s_len(&pfunc->arg[1].lstr) ) {
-            u8c_t ct = led_u8s_char_next(&pfunc->arg[1].lstr, &k);
-            if (led_u8s_char_next(&pfunc->arg[0].lstr, &j) == c) {
-                led_u8s_app_char(&led.line_write.lstr, ct);
-                sub = true;
-                break;
+    led_u8s_t* lstr = &led.line_write->lstr;
+    led_u8s_t* lsrc = &led.line_prep->lstr;
+    size_t i = led.line_prep->zone_start;
+    size_t stop = led.line_prep->zone_stop;
+    if (pfunc->tr.ascii) {
+        while (i < stop) {
+            size_t len = led_u8s_room(lstr, stop - i);
+            size_t n = led_u8s_map_ascii(lstr->str + lstr->len, lsrc->str + i, len, pfunc->tr.ascii_map, pfunc->tr.ascii_blocks);
+            lstr->len += n;
+            i += n;
+            // a multibyte char stops the ASCII run, a full buffer stops the translation
+            if (n == len) break;
+            while (i < stop && (uint8_t)lsrc->str[i] >= 0x80) {
+                u8c_t c = led_u8s_char_next(lsrc, &i);
+                led_u8s_app_char(lstr, c);
             }
         }
-        // if no substitution has been done
-        if (!sub)
-            led_u8s_app_char(&led.line_write.lstr, c);
+        lstr->str[lstr->len] = '\0';
+    }
+    else {
+        u8c_t last = LED_TR_DELETE;
+        while (i < stop) {
+            u8c_t c = led_fn_tr_map(pfunc, led_u8s_char_next(lsrc, &i));
+            if (c == LED_TR_DELETE) continue;
+            if (pfunc->tr.squeeze && c == last && led_fn_tr_issqueezed(pfunc, c)) continue;
+            led_u8s_app_char(lstr, c);
+            last = c;
+        }
     }
     led_zone_post_process();
 }
 
 void led_fn_impl_case_lower(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
-
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
-    }
-
+    led_u8s_app_case_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop, false);
     led_zone_post_process();
 }
 
 void led_fn_impl_case_upper(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
-
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        led_u8s_app_char(&led.line_write.lstr, led_u8c_toupper(c));
-    }
-
+    led_u8s_app_case_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop, true);
     led_zone_post_process();
 }
 
 void led_fn_impl_case_first(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
-    size_t i = led.line_prep.zone_start;
-    led_u8s_app_char(&led.line_write.lstr, led_u8c_toupper(led_u8s_char_next(&led.line_prep.lstr, &i)));
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
-    }
+    size_t i = led.line_prep->zone_start;
+    led_u8s_app_char(&led.line_write->lstr, led_u8c_toupper(led_u8s_char_next(&led.line_prep->lstr, &i)));
+    led_u8s_app_case_zn(&led.line_write->lstr, &led.line_prep->lstr, i, led.line_prep->zone_stop, false);
 
     led_zone_post_process();
 }
@@ -327,13 +512,13 @@ void led_fn_impl_case_camel(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
     bool wasword = false;
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
+    size_t i = led.line_prep->zone_start;
+    while ( i < led.line_prep->zone_stop ) {
+        u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &i);
         bool isword = led_u8c_isalnum(c) || c == '_';
         if (isword) {
-            if (wasword) led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
-            else led_u8s_app_char(&led.line_write.lstr, led_u8c_toupper(c));
+            if (wasword) led_u8s_app_char(&led.line_write->lstr, led_u8c_tolower(c));
+            else led_u8s_app_char(&led.line_write->lstr, led_u8c_toupper(c));
         }
         wasword = isword;
     }
@@ -344,14 +529,14 @@ void led_fn_impl_case_camel(led_fn_t* pfunc) {
 void led_fn_impl_case_snake(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        char cn = led_u8s_char_at(&led.line_write.lstr, i);
+    size_t i = led.line_prep->zone_start;
+    while ( i < led.line_prep->zone_stop ) {
+        u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &i);
+        char cn = i < led_u8s_len(&led.line_write->lstr) ? led_u8s_char_at(&led.line_write->lstr, i) : '\0';
         if (led_u8c_isalnum(c))
-            led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
+            led_u8s_app_char(&led.line_write->lstr, led_u8c_tolower(c));
         else if (cn != '_')
-            led_u8s_app_char(&led.line_write.lstr, '_');
+            led_u8s_app_char(&led.line_write->lstr, '_');
     }
 
     led_zone_post_process();
@@ -360,14 +545,14 @@ void led_fn_impl_case_snake(led_fn_t* pfunc) {
 void led_fn_impl_quote_base(led_fn_t* pfunc, u8c_t q) {
     led_zone_pre_process(pfunc);
 
-    if (! (led_u8s_char_at(&led.line_prep.lstr, led.line_prep.zone_start) == q && led_u8s_char_at(&led.line_prep.lstr, led.line_prep.zone_stop - 1) == q) ) {
-        led_debug("quote active");
-        led_u8s_app_char(&led.line_write.lstr, q);
-        led_line_append_zone(&led.line_write, &led.line_prep);
-        led_u8s_app_char(&led.line_write.lstr, q);
+    if (! (led_u8s_char_at(&led.line_prep->lstr, led.line_prep->zone_start) == q && led_u8s_char_at(&led.line_prep->lstr, led.line_prep->zone_stop - 1) == q) ) {
+        led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "quote active");
+        led_u8s_app_char(&led.line_write->lstr, q);
+        led_line_append_zone(led.line_write, led.line_prep);
+        led_u8s_app_char(&led.line_write->lstr, q);
     }
     else
-        led_line_append_zone(&led.line_write, &led.line_prep);
+        led_line_append_zone(led.line_write, led.line_prep);
 
     led_zone_post_process();
 }
@@ -382,18 +567,18 @@ void led_fn_impl_quote_remove(led_fn_t* pfunc) {
 
     char q = QUOTES[0];
     for(size_t i = 0; q != '\0'; i++, q = QUOTES[i]) {
-        if (led_u8s_char_at(&led.line_prep.lstr, led.line_prep.zone_start) == (u8c_t)q
-            && led_u8s_char_at(&led.line_prep.lstr, led.line_prep.zone_stop - 1) == (u8c_t)q
+        if (led_u8s_char_at(&led.line_prep->lstr, led.line_prep->zone_start) == (u8c_t)q
+            && led_u8s_char_at(&led.line_prep->lstr, led.line_prep->zone_stop - 1) == (u8c_t)q
             )
             break;
     }
 
     if (q) {
-        led_debug("quotes found: %c", q);
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start + 1, led.line_prep.zone_stop - 1);
+        led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "quotes found: %c", q);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start + 1, led.line_prep->zone_stop - 1);
     }
     else
-        led_line_append_zone(&led.line_write, &led.line_prep);
+        led_line_append_zone(led.line_write, led.line_prep);
 
     led_zone_post_process();
 }
@@ -403,21 +588,21 @@ void led_fn_impl_quote_remove(led_fn_t* pfunc) {
 void led_fn_impl_trim(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    size_t str_start = led.line_prep.zone_start;
-    while ( str_start < led.line_prep.zone_stop ) {
+    size_t str_start = led.line_prep->zone_start;
+    while ( str_start < led.line_prep->zone_stop ) {
         size_t in = str_start;
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &in);
+        u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &in);
         if (!led_u8c_isspace(c)) break;
         str_start = in;
     }
-    size_t str_stop = led.line_prep.zone_stop;
+    size_t str_stop = led.line_prep->zone_stop;
     while ( str_stop > str_start ) {
         size_t ip = str_stop;
-        u8c_t c = led_u8s_char_prev(&led.line_prep.lstr, &ip);
+        u8c_t c = led_u8s_char_prev(&led.line_prep->lstr, &ip);
         if (!led_u8c_isspace(c)) break;
         str_stop = ip;
     }
-    led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, str_start, str_stop);
+    led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, str_start, str_stop);
 
     led_zone_post_process();
 }
@@ -425,14 +610,14 @@ void led_fn_impl_trim(led_fn_t* pfunc) {
 void led_fn_impl_trim_left(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    size_t str_start = led.line_prep.zone_start;
-    while ( str_start < led.line_prep.zone_stop ) {
+    size_t str_start = led.line_prep->zone_start;
+    while ( str_start < led.line_prep->zone_stop ) {
         size_t in = str_start;
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &in);
+        u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &in);
         if (!led_u8c_isspace(c)) break;
         str_start = in;
     }
-    led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, str_start, led.line_prep.zone_stop);
+    led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, str_start, led.line_prep->zone_stop);
 
     led_zone_post_process();
 }
@@ -440,14 +625,14 @@ void led_fn_impl_trim_left(led_fn_t* pfunc) {
 void led_fn_impl_trim_right(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    size_t str_stop = led.line_prep.zone_stop;
-    while ( str_stop > led.line_prep.zone_start ) {
+    size_t str_stop = led.line_prep->zone_stop;
+    while ( str_stop > led.line_prep->zone_start ) {
         size_t ip = str_stop;
-        u8c_t c = led_u8s_char_prev(&led.line_prep.lstr, &ip);
+        u8c_t c = led_u8s_char_prev(&led.line_prep->lstr, &ip);
         if (!led_u8c_isspace(c)) break;
         str_stop = ip;
     }
-    led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start, str_stop);
+    led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, str_stop);
 
     led_zone_post_process();
 }
@@ -455,96 +640,61 @@ void led_fn_impl_trim_right(led_fn_t* pfunc) {
 void led_fn_impl_base64_encode(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    char b64buf[LED_BUF_MAX];
-    base64_encodestate base64_state;
-	size_t count = 0;
-
-	base64_init_encodestate(&base64_state);
-	count = base64_encode_block(
-        led_u8s_str_at(&led.line_prep.lstr, led.line_prep.zone_start),
-        led.line_prep.zone_stop - led.line_prep.zone_start,
-        b64buf,
-        &base64_state);
-	count += base64_encode_blockend(
-        b64buf + count,
-        &base64_state);
-    // remove newline and final 0
-    b64buf[count - 1] = '\0';
-
-    led_u8s_app_str(&led.line_write.lstr, b64buf);
+    // encode directly at the end of the write line, the options are compiled in the arg value
+    led_u8s_app_b64_encode_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop, pfunc->arg[0].uval);
+
     led_zone_post_process();
 }
 
 void led_fn_impl_base64_decode(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    char b64buf[LED_BUF_MAX];
-	base64_decodestate base64_state;
-	size_t count = 0;
+    // decode directly at the end of the write line, the strings are sized so null bytes are kept
+    led_u8s_app_b64_decode_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop);
 
-	base64_init_decodestate(&base64_state);
-	count = base64_decode_block(
-        led_u8s_str_at(&led.line_prep.lstr, led.line_prep.zone_start),
-        led.line_prep.zone_stop - led.line_prep.zone_start,
-        b64buf,
-        &base64_state);
-    b64buf[count] = '\0';
-
-    led_u8s_app_str(&led.line_write.lstr, b64buf);
     led_zone_post_process();
 }
 
-void led_fn_impl_url_encode(led_fn_t* pfunc) {
+void led_fn_escape_base(led_fn_t* pfunc, const led_esc_t* pesc) {
     led_zone_pre_process(pfunc);
-
-    static const char HEX[] = "0123456789ABCDEF";
-    char pcbuf[4] = "%00";
-
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        // we encode UTF8 chars byte per byte.
-        u8c_t c = led_u8s_str(&led.line_prep.lstr)[i++];
-        if (led_u8c_isalnum(c))
-            led_u8s_app_char(&led.line_write.lstr, c);
-        else {
-            pcbuf[1] = HEX[(c >> 4) & 0x0F];
-            pcbuf[2] = HEX[c & 0x0F];
-            led_u8s_app_str(&led.line_write.lstr, pcbuf);
-        }
-    }
-
+    led_u8s_app_esc_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop, pesc);
     led_zone_post_process();
 }
 
-void led_fn_impl_shell_escape(led_fn_t* pfunc) {
-    static const char fname_stdchar_table[] = "/._-~:=%";
-    led_u8s_decl_str(table, fname_stdchar_table);
-
+void led_fn_unescape_base(led_fn_t* pfunc, led_unesc_t scheme) {
     led_zone_pre_process(pfunc);
-    size_t i = led.line_prep.zone_start;
-    while ( i < led.line_prep.zone_stop ) {
-        u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &i);
-        if (led_u8c_isalnum(c) || led_u8s_ischar(&table, c))
-            led_u8s_app_char(&led.line_write.lstr, c);
-        else {
-            led_u8s_app_char(&led.line_write.lstr, '\\');
-            led_u8s_app_char(&led.line_write.lstr, c);
-        }
-    }
-
+    led_u8s_app_unesc_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, led.line_prep->zone_stop, scheme);
     led_zone_post_process();
 }
 
-void led_fn_impl_shell_unescape(led_fn_t* pfunc) {
+void led_fn_impl_url_encode(led_fn_t* pfunc) { led_fn_escape_base(pfunc, &led_fn_esc_url); }
+void led_fn_impl_url_decode(led_fn_t* pfunc) { led_fn_unescape_base(pfunc, LED_UNESC_URL); }
+void led_fn_impl_shell_escape(led_fn_t* pfunc) { led_fn_escape_base(pfunc, &led_fn_esc_shell); }
+void led_fn_impl_shell_unescape(led_fn_t* pfunc) { led_fn_unescape_base(pfunc, LED_UNESC_SHELL); }
+void led_fn_impl_c_escape(led_fn_t* pfunc) { led_fn_escape_base(pfunc, &led_fn_esc_c); }
+void led_fn_impl_c_unescape(led_fn_t* pfunc) { led_fn_unescape_base(pfunc, LED_UNESC_C); }
+void led_fn_impl_json_escape(led_fn_t* pfunc) { led_fn_escape_base(pfunc, &led_fn_esc_json); }
+void led_fn_impl_json_unescape(led_fn_t* pfunc) { led_fn_unescape_base(pfunc, LED_UNESC_JSON); }
+
+void led_fn_impl_hash(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    for (size_t i = led.line_prep.zone_start; i < led.line_prep.zone_stop; i++) {
-        bool wasesc = false;
-        char c = led_u8s_char_at(&led.line_prep.lstr, i);
-        if (!wasesc && c == '\\')
-            wasesc = true;
-        else
-            led_u8s_app_char(&led.line_write.lstr, c);
+    // the digest is computed in place on the zone, a whole pack included
+    uint8_t digest[LED_HASH_SIZE_MAX];
+    size_t len = led_hash_digest(pfunc->arg[0].uval, led.line_prep->lstr.str + led.line_prep->zone_start,
+        led.line_prep->zone_stop - led.line_prep->zone_start, digest);
+    if (pfunc->arg[1].uval & LED_HASH_ENC_B64) {
+        led_u8s_t ldigest = { (char*)digest, len, len + 1, NULL };
+        led_u8s_app_b64_encode_zn(&led.line_write->lstr, &ldigest, 0, len, pfunc->arg[1].uval & ~LED_HASH_ENC_B64);
+    }
+    else {
+        static const char hexa[] = "0123456789abcdef";
+        char hex[2 * LED_HASH_SIZE_MAX];
+        for (size_t i = 0; i < len; i++) {
+            hex[2 * i] = hexa[digest[i] >> 4];
+            hex[2 * i + 1] = hexa[digest[i] & 0xF];
+        }
+        led_u8s_app_buf(&led.line_write->lstr, hex, 2 * len);
     }
 
     led_zone_post_process();
@@ -553,15 +703,18 @@ void led_fn_impl_shell_unescape(led_fn_t* pfunc) {
 void led_fn_impl_realpath(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    char c = led.line_prep.buf[led.line_prep.zone_stop]; // temporary save this char for realpath function
-    led.line_prep.buf[led.line_prep.zone_stop] = '\0';
-    if (realpath(led_u8s_str_at(&led.line_prep.lstr, led.line_prep.zone_start), led.line_write.buf + led_u8s_len(&led.line_write.lstr)) != NULL ) {
-        led.line_prep.buf[led.line_prep.zone_stop] = c;
-        led_u8s_init_buf(&led.line_write.lstr, led.line_write.buf);
+    char c = led.line_prep->lstr.str[led.line_prep->zone_stop]; // temporary save this char for realpath function
+    led.line_prep->lstr.str[led.line_prep->zone_stop] = '\0';
+    led_u8s_room(&led.line_write->lstr, PATH_MAX);
+    char* rpath = led_u8s_str(&led.line_write->lstr) + led_u8s_len(&led.line_write->lstr);
+    if (realpath(led_u8s_str_at(&led.line_prep->lstr, led.line_prep->zone_start), rpath) != NULL ) {
+        led.line_prep->lstr.str[led.line_prep->zone_stop] = c;
+        led.line_write->lstr.len += strlen(rpath);
     }
     else {
-        led.line_prep.buf[led.line_prep.zone_stop] = c;
-        led_line_append_zone(&led.line_write, &led.line_prep);
+        led.line_prep->lstr.str[led.line_prep->zone_stop] = c;
+        rpath[0] = '\0';
+        led_line_append_zone(led.line_write, led.line_prep);
     }
 
     led_zone_post_process();
@@ -570,9 +723,9 @@ void led_fn_impl_realpath(led_fn_t* pfunc) {
 void led_fn_impl_dirname(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    const char* dir = dirname(led_u8s_str_at(&led.line_prep.lstr, led.line_prep.zone_start));
-    if (dir != NULL) led_u8s_app_str(&led.line_write.lstr, dir);
-    else led_line_append_zone(&led.line_write, &led.line_prep);
+    const char* dir = dirname(led_u8s_str_at(&led.line_prep->lstr, led.line_prep->zone_start));
+    if (dir != NULL) led_u8s_app_str(&led.line_write->lstr, dir);
+    else led_line_append_zone(led.line_write, led.line_prep);
 
     led_zone_post_process();
 }
@@ -580,9 +733,9 @@ void led_fn_impl_dirname(led_fn_t* pfunc) {
 void led_fn_impl_basename(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    const char* fname = basename(led_u8s_str_at(&led.line_prep.lstr, led.line_prep.zone_start));
-    if (fname != NULL) led_u8s_app_str(&led.line_write.lstr, fname);
-    else led_line_append_zone(&led.line_write, &led.line_prep);
+    const char* fname = basename(led_u8s_str_at(&led.line_prep->lstr, led.line_prep->zone_start));
+    if (fname != NULL) led_u8s_app_str(&led.line_write->lstr, fname);
+    else led_line_append_zone(led.line_write, led.line_prep);
 
     led_zone_post_process();
 }
@@ -590,81 +743,185 @@ void led_fn_impl_basename(led_fn_t* pfunc) {
 void led_fn_impl_revert(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    size_t i = led.line_prep.zone_stop;
-    while ( i > led.line_prep.zone_start )
-        led_u8s_app_char(&led.line_write.lstr, led_u8s_char_prev(&led.line_prep.lstr, &i));
+    size_t i = led.line_prep->zone_stop;
+    if (led.line_prep->ascii) {
+        // ASCII line, chars are bytes
+        led_u8s_t* lstr = &led.line_write->lstr;
+        size_t len = led_u8s_room(lstr, i - led.line_prep->zone_start);
+        for (size_t j = 0; j < len; j++)
+            lstr->str[lstr->len++] = led.line_prep->lstr.str[--i];
+        lstr->str[lstr->len] = '\0';
+    }
+    else {
+        while ( i > led.line_prep->zone_start )
+            led_u8s_app_char(&led.line_write->lstr, led_u8s_char_prev(&led.line_prep->lstr, &i));
+    }
 
     led_zone_post_process();
 }
 
-void led_fn_impl_field_base(led_fn_t* pfunc, const char* field_sep) {
-    led_u8s_decl_str(sepsval, field_sep);
+void led_fn_impl_field_base(led_fn_t* pfunc, const led_charset_t* pseps) {
     led_zone_pre_process(pfunc);
     size_t field_n = pfunc->arg[0].uval;
-    size_t n = 0;
-    bool was_sep = true;
-    size_t str_start = led.line_prep.zone_start;
-    size_t str_stop = led.line_prep.zone_stop;
-    while ( str_start < led.line_prep.zone_stop ) {
-        size_t in = str_start;
-        bool is_sep = led_u8s_ischar(&sepsval, led_u8s_char_next(&led.line_prep.lstr, &in));
-        if (was_sep && !is_sep) {
-            n++;
-            if (n == field_n) break;
+    led_u8s_t* lstr = &led.line_prep->lstr;
+    size_t start = led.line_prep->zone_start;
+    size_t stop = led.line_prep->zone_stop;
+    // the fields are the runs out of the separators, a run of separators counts once
+    for (size_t n = 1; n <= field_n; n++) {
+        start = led_charset_skip(pseps, lstr, start, stop);
+        if (start >= stop) break;
+        size_t end = led_charset_find(pseps, lstr, start, stop);
+        if (n == field_n)
+            led_u8s_app_zn(&led.line_write->lstr, lstr, start, end);
+        start = end;
+    }
+
+    led_zone_post_process();
+}
+
+void led_fn_impl_field(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, &pfunc->sep); }
+void led_fn_impl_field_csv(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, &led_fn_seps_csv); }
+void led_fn_impl_field_space(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, &led_fn_seps_space); }
+void led_fn_impl_field_mixed(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, &led_fn_seps_mixed); }
+
+void led_fn_init_base64(led_fn_t* pfunc, size_t iarg) {
+    // b64e/[regex][/opts]: u for the URL-safe alphabet, n for no padding
+    led_u8s_t* lopts = &pfunc->arg[iarg].lstr;
+    for (size_t i = 0; i < led_u8s_len(lopts); i++) {
+        char opt = led_u8s_char_at(lopts, i);
+        led_assert(opt == 'u' || opt == 'n', LED_ERR_ARG, "base64: bad option %c", opt);
+        pfunc->arg[iarg].uval |= opt == 'u' ? LED_B64_URL : LED_B64_NOPAD;
+    }
+}
+
+void led_fn_init_hash(led_fn_t* pfunc, size_t iarg) {
+    // hash/[regex]/algo[/enc]: crc32c, xxh3 or sha256, encoded in hex (default), b64 or b64u
+    static const char* algos[] = { "crc32c", "xxh3", "sha256" };
+    char* algo = led_u8s_str(&pfunc->arg[iarg].lstr);
+    size_t ialgo = 0;
+    while (ialgo < sizeof algos / sizeof *algos && strcmp(algo, algos[ialgo]) != 0) ialgo++;
+    led_assert(ialgo < sizeof algos / sizeof *algos, LED_ERR_ARG, "hash: unknown algo %s", algo);
+    pfunc->arg[iarg].uval = ialgo;
+
+    led_u8s_t* lenc = &pfunc->arg[iarg + 1].lstr;
+    if (!led_u8s_isinit(lenc) || strcmp(led_u8s_str(lenc), "hex") == 0) return;
+    if (strcmp(led_u8s_str(lenc), "b64") == 0)
+        pfunc->arg[iarg + 1].uval = LED_HASH_ENC_B64;
+    else if (strcmp(led_u8s_str(lenc), "b64u") == 0)
+        pfunc->arg[iarg + 1].uval = LED_HASH_ENC_B64 | LED_B64_URL | LED_B64_NOPAD;
+    else
+        led_assert(false, LED_ERR_ARG, "hash: unknown encoding %s", led_u8s_str(lenc));
+}
+
+void led_fn_init_field_list(led_fn_t* pfunc, size_t iarg) {
+    // cut style list: N, N-M, N- or -M separated by commas, fields from 1
+    led_u8s_t* llist = &pfunc->arg[iarg].lstr;
+    char* str = led_u8s_str(llist);
+    memset(&pfunc->cut, 0, sizeof pfunc->cut);
+    while (*str) {
+        char* end = str;
+        size_t first = *str == '-' ? 1 : strtoul(str, &end, 10);
+        size_t last = first;
+        if (*end == '-') {
+            str = end + 1;
+            last = isdigit(*str) ? strtoul(str, &end, 10) : 0;
+            if (last == 0) end = str;
         }
-        was_sep = is_sep;
-        str_start = in;
+        led_assert(first > 0 && (*end == ',' || *end == '\0') && (last == 0 || last >= first), LED_ERR_ARG,
+            "function arg %i: bad field list: %s", iarg+1, led_u8s_str(llist));
+        if (last == 0 || last >= LED_CUT_FIELD_MAX) {
+            // open range, to the line end
+            if (pfunc->cut.from == 0 || first < pfunc->cut.from) pfunc->cut.from = first;
+            last = LED_CUT_FIELD_MAX - 1;
+        }
+        for (size_t f = first; f <= last && f < LED_CUT_FIELD_MAX; f++)
+            pfunc->cut.field[f / 64] |= (uint64_t)1 << (f % 64);
+        if (last > pfunc->cut.last) pfunc->cut.last = last;
+        str = *end ? end + 1 : end;
+    }
+    if (pfunc->cut.from) pfunc->cut.last = SIZE_MAX;
+    led_debug("function arg %i: field list found: %s", iarg+1, led_u8s_str(llist));
+}
+
+static bool led_fn_cut_isfield(led_fn_t* pfunc, size_t n) {
+    if (n < LED_CUT_FIELD_MAX) return pfunc->cut.field[n / 64] & ((uint64_t)1 << (n % 64));
+    return pfunc->cut.from > 0 && n >= pfunc->cut.from;
+}
+
+void led_fn_impl_field_cut(led_fn_t* pfunc) {
+    led_zone_pre_process(pfunc);
+    // fields as cut: each separator ends a field, the empty fields count
+    const led_charset_t* pseps = led_u8s_isinit(&pfunc->arg[1].lstr) ? &pfunc->sep : &led_fn_seps_tab;
+    led_u8s_t lsep_default;
+    led_u8s_t* lsep = &pfunc->arg[2].lstr;
+    if (!led_u8s_isinit(lsep)) {
+        // the output delimiter is the first separator char by default
+        lsep = &lsep_default;
+        if (led_u8s_isinit(&pfunc->arg[1].lstr)) led_u8s_clone(lsep, &pfunc->arg[1].lstr);
+        else led_u8s_init_str(lsep, "\t");
+        lsep->len = led_u8c_size(lsep->str);
     }
-    if (n == field_n) {
-        was_sep = false;
-        str_stop = str_start;
-        while (str_stop < led.line_prep.zone_stop ) {
-            size_t in = str_stop;
-            bool is_sep = led_u8s_ischar(&sepsval, led_u8s_char_next(&led.line_prep.lstr, &in));
-            if (!was_sep && is_sep) break;
-            str_stop = in;
+    led_u8s_t* lstr = &led.line_prep->lstr;
+    size_t start = led.line_prep->zone_start;
+    size_t stop = led.line_prep->zone_stop;
+    if (led_charset_find(pseps, lstr, start, stop) >= stop) {
+        // a zone without separator is kept whole, as cut does
+        led_u8s_app_zn(&led.line_write->lstr, lstr, start, stop);
+        led_zone_post_process();
+        return;
+    }
+    bool isfirst = true;
+    for (size_t n = 1; n <= pfunc->cut.last; n++) {
+        size_t end = led_charset_find(pseps, lstr, start, stop);
+        if (led_fn_cut_isfield(pfunc, n)) {
+            if (!isfirst) led_u8s_app(&led.line_write->lstr, lsep);
+            led_u8s_app_zn(&led.line_write->lstr, lstr, start, end);
+            isfirst = false;
         }
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, str_start, str_stop);
+        if (end >= stop) break;
+        start = end;
+        led_u8s_char_next(lstr, &start);
     }
 
     led_zone_post_process();
 }
 
-void led_fn_impl_field(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, led_u8s_str(&pfunc->arg[1].lstr)); }
-void led_fn_impl_field_csv(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, ",;"); }
-void led_fn_impl_field_space(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, " \t\n"); }
-void led_fn_impl_field_mixed(led_fn_t* pfunc) { led_fn_impl_field_base(pfunc, ",; \t\n"); }
-
 void led_fn_impl_join(led_fn_t*) {
-    led_u8s_foreach_char(&led.line_prep.lstr) {
-        if ( c != '\n') led_u8s_app_char(&led.line_write.lstr, c);
+    led_u8s_foreach_char(&led.line_prep->lstr) {
+        if ( c != '\n') led_u8s_app_char(&led.line_write->lstr, c);
     }
 }
 
 //TODO Continue U8 convertion
 
-void led_fn_impl_split_base(led_fn_t* pfunc, const char* field_sep) {
-    led_u8s_decl_str(sepsval, field_sep);
+void led_fn_impl_split_base(led_fn_t* pfunc, const led_charset_t* pseps) {
     led_zone_pre_process(pfunc);
-
-    led_u8s_foreach_char_zone(&led.line_prep.lstr, led.line_prep.zone_start, led_u8s_len(&led.line_prep.lstr)) {
-        if ( led_u8s_ischar(&sepsval, c) ) c = '\n';
-        led_u8s_app_char(&led.line_write.lstr, c);
+    led_u8s_t* lstr = &led.line_prep->lstr;
+    size_t start = led.line_prep->zone_start;
+    size_t stop = led.line_prep->zone_stop;
+    // the runs between separators are copied at once, each separator becomes a new line
+    while (start < stop) {
+        size_t end = led_charset_find(pseps, lstr, start, stop);
+        led_u8s_app_zn(&led.line_write->lstr, lstr, start, end);
+        if (end >= stop) break;
+        led_u8s_app_char(&led.line_write->lstr, '\n');
+        start = end;
+        led_u8s_char_next(lstr, &start);
     }
     led_zone_post_process();
 }
 
-void led_fn_impl_split(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, led_u8s_str(&pfunc->arg[0].lstr)); }
-void led_fn_impl_split_space(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, " \t\n"); }
-void led_fn_impl_split_csv(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, ",;"); }
-void led_fn_impl_split_mixed(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, ",; \t\n"); }
+void led_fn_impl_split(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, &pfunc->sep); }
+void led_fn_impl_split_space(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, &led_fn_seps_space); }
+void led_fn_impl_split_csv(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, &led_fn_seps_csv); }
+void led_fn_impl_split_mixed(led_fn_t* pfunc) { led_fn_impl_split_base(pfunc, &led_fn_seps_mixed); }
 
 void led_fn_impl_randomize_base(led_fn_t* pfunc, const char* charset, size_t len) {
     led_zone_pre_process(pfunc);
 
-    for (size_t i = led.line_prep.zone_start; i < led.line_prep.zone_stop; i++) {
+    for (size_t i = led.line_prep->zone_start; i < led.line_prep->zone_stop; i++) {
         char c = charset[rand() % len];
-        led_u8s_app_char(&led.line_write.lstr, c);
+        led_u8s_app_char(&led.line_write->lstr, c);
     }
 
     led_zone_post_process();
@@ -683,33 +940,33 @@ void led_fn_impl_randomize_hexa(led_fn_t* pfunc) { led_fn_impl_randomize_base(pf
 void led_fn_impl_randomize_mixed(led_fn_t* pfunc) { led_fn_impl_randomize_base(pfunc, randomize_table_mixed, sizeof randomize_table_mixed - 1); }
 
 size_t led_fn_helper_fname_pos() {
-    size_t iname = led_u8s_rfind_char_zn(&led.line_prep.lstr, '/', led.line_prep.zone_start, led.line_prep.zone_stop);
-    if (iname == led_u8s_len(&led.line_prep.lstr)) iname = led.line_prep.zone_start;
+    size_t iname = led_u8s_rfind_char_zn(&led.line_prep->lstr, '/', led.line_prep->zone_start, led.line_prep->zone_stop);
+    if (iname == led_u8s_len(&led.line_prep->lstr)) iname = led.line_prep->zone_start;
     else iname++;
-    led_debug("led_fn_helper_fname_pos iname: %u %s", iname, led_u8s_str_at(&led.line_prep.lstr, iname));
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_fn_helper_fname_pos iname: %u %s", iname, led_u8s_str_at(&led.line_prep->lstr, iname));
     return iname;
 }
 
 void led_fn_impl_fname_lower(led_fn_t* pfunc) {
-    led_debug("led_fn_impl_fname_lower");
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_fn_impl_fname_lower");
     led_zone_pre_process(pfunc);
 
-    if (led.line_prep.zone_start < led.line_prep.zone_stop) {
+    if (led.line_prep->zone_start < led.line_prep->zone_stop) {
         size_t iname = led_fn_helper_fname_pos();
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start, iname);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, iname);
 
-        while ( iname < led.line_prep.zone_stop ) {
-            u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &iname);
+        while ( iname < led.line_prep->zone_stop ) {
+            u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &iname);
             if (led_u8c_isalnum(c))
-                led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
+                led_u8s_app_char(&led.line_write->lstr, led_u8c_tolower(c));
             else if (c == '.') {
-                if (!led_u8c_isalnum(led_u8s_char_last(&led.line_write.lstr)))
-                    led_u8s_trunk_char_last(&led.line_write.lstr);
-                led_u8s_app_char(&led.line_write.lstr, c);
+                if (!led_u8c_isalnum(led_u8s_char_last(&led.line_write->lstr)))
+                    led_u8s_trunk_char_last(&led.line_write->lstr);
+                led_u8s_app_char(&led.line_write->lstr, c);
             }
             else {
-                if (led_u8c_isalnum(led_u8s_char_last(&led.line_write.lstr)))
-                    led_u8s_app_char(&led.line_write.lstr, '_');
+                if (led_u8c_isalnum(led_u8s_char_last(&led.line_write->lstr)))
+                    led_u8s_app_char(&led.line_write->lstr, '_');
             }
         }
     }
@@ -717,25 +974,25 @@ void led_fn_impl_fname_lower(led_fn_t* pfunc) {
 }
 
 void led_fn_impl_fname_upper(led_fn_t* pfunc) {
-    led_debug("led_fn_impl_fname_upper");
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_fn_impl_fname_upper");
     led_zone_pre_process(pfunc);
 
-    if (led.line_prep.zone_start < led.line_prep.zone_stop) {
+    if (led.line_prep->zone_start < led.line_prep->zone_stop) {
         size_t iname = led_fn_helper_fname_pos();
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start, iname);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, iname);
 
-        while ( iname < led.line_prep.zone_stop ) {
-            u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &iname);
+        while ( iname < led.line_prep->zone_stop ) {
+            u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &iname);
             if (led_u8c_isalnum(c))
-                led_u8s_app_char(&led.line_write.lstr, led_u8c_toupper(c));
+                led_u8s_app_char(&led.line_write->lstr, led_u8c_toupper(c));
             else if (c == '.') {
-                if (!led_u8c_isalnum(led_u8s_char_last(&led.line_write.lstr)))
-                    led_u8s_trunk_char_last(&led.line_write.lstr);
-                led_u8s_app_char(&led.line_write.lstr, c);
+                if (!led_u8c_isalnum(led_u8s_char_last(&led.line_write->lstr)))
+                    led_u8s_trunk_char_last(&led.line_write->lstr);
+                led_u8s_app_char(&led.line_write->lstr, c);
             }
             else {
-                if (led_u8c_isalnum(led_u8s_char_last(&led.line_write.lstr)))
-                    led_u8s_app_char(&led.line_write.lstr, '_');
+                if (led_u8c_isalnum(led_u8s_char_last(&led.line_write->lstr)))
+                    led_u8s_app_char(&led.line_write->lstr, '_');
             }
         }
     }
@@ -743,26 +1000,26 @@ void led_fn_impl_fname_upper(led_fn_t* pfunc) {
 }
 
 void led_fn_impl_fname_camel(led_fn_t* pfunc) {
-    led_debug("led_fn_impl_fname_camel");
+    led_trace(LED_TRACE_FUNC, LED_TRACE_DETAIL, "led_fn_impl_fname_camel");
     led_zone_pre_process(pfunc);
 
-    if (led.line_prep.zone_start < led.line_prep.zone_stop) {
+    if (led.line_prep->zone_start < led.line_prep->zone_stop) {
         size_t iname = led_fn_helper_fname_pos();
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start, iname);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, iname);
 
         bool wasword = true;
         bool isfirst = true;
-        while ( iname < led.line_prep.zone_stop ) {
-            u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &iname);
-            if (led_u8c_isalnum(led_u8s_char_last(&led.line_write.lstr)) && c == '.') {
-                led_u8s_app_char(&led.line_write.lstr, c);
+        while ( iname < led.line_prep->zone_stop ) {
+            u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &iname);
+            if (led_u8c_isalnum(led_u8s_char_last(&led.line_write->lstr)) && c == '.') {
+                led_u8s_app_char(&led.line_write->lstr, c);
                 isfirst = true;
             }
             else {
                 bool isword = led_u8c_isalnum(c);
                 if (isword) {
-                    if (wasword || isfirst) led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
-                    else led_u8s_app_char(&led.line_write.lstr, led_u8c_toupper(c));
+                    if (wasword || isfirst) led_u8s_app_char(&led.line_write->lstr, led_u8c_tolower(c));
+                    else led_u8s_app_char(&led.line_write->lstr, led_u8c_toupper(c));
                     isfirst = false;
                 }
                 wasword = isword;
@@ -775,23 +1032,23 @@ void led_fn_impl_fname_camel(led_fn_t* pfunc) {
 void led_fn_impl_fname_snake(led_fn_t* pfunc) {
     led_zone_pre_process(pfunc);
 
-    if (led.line_prep.zone_start < led.line_prep.zone_stop) {
+    if (led.line_prep->zone_start < led.line_prep->zone_stop) {
         size_t iname = led_fn_helper_fname_pos();
-        led_u8s_app_zn(&led.line_write.lstr, &led.line_prep.lstr, led.line_prep.zone_start, iname);
+        led_u8s_app_zn(&led.line_write->lstr, &led.line_prep->lstr, led.line_prep->zone_start, iname);
 
-        while ( iname < led.line_prep.zone_stop ) {
-            u8c_t c = led_u8s_char_next(&led.line_prep.lstr, &iname);
-            u8c_t lc = led_u8s_char_last(&led.line_write.lstr);
+        while ( iname < led.line_prep->zone_stop ) {
+            u8c_t c = led_u8s_char_next(&led.line_prep->lstr, &iname);
+            u8c_t lc = led_u8s_char_last(&led.line_write->lstr);
             if (led_u8c_isalnum(c))
-                led_u8s_app_char(&led.line_write.lstr, led_u8c_tolower(c));
+                led_u8s_app_char(&led.line_write->lstr, led_u8c_tolower(c));
             else if (c == '.') {
-                led_u8s_trunk_char(&led.line_write.lstr, '.');
-                led_u8s_trunk_char(&led.line_write.lstr, '_');
-                led_u8s_app_char(&led.line_write.lstr, '.');
+                led_u8s_trunk_char(&led.line_write->lstr, '.');
+                led_u8s_trunk_char(&led.line_write->lstr, '_');
+                led_u8s_app_char(&led.line_write->lstr, '.');
             }
             else if (lc != '\0' && lc != '.') {
-                led_u8s_trunk_char(&led.line_write.lstr, '_');
-                led_u8s_app_char(&led.line_write.lstr, '_');
+                led_u8s_trunk_char(&led.line_write->lstr, '_');
+                led_u8s_app_char(&led.line_write->lstr, '_');
             }
         }
     }
@@ -806,14 +1063,14 @@ void led_fn_impl_generate(led_fn_t* pfunc) {
     u8c_t c = led_u8s_char_first(&pfunc->arg[0].lstr);
 
     if ( pfunc->arg[1].uval > 0  ) {
-        for (size_t i = led.line_prep.zone_start; i < pfunc->arg[1].uval; i++)
-            led_u8s_app_char(&led.line_write.lstr, c);
+        for (size_t i = led.line_prep->zone_start; i < pfunc->arg[1].uval; i++)
+            led_u8s_app_char(&led.line_write->lstr, c);
     }
     else {
-        size_t i = led.line_prep.zone_start;
-        while (i < led.line_prep.zone_stop) {
-            led_u8s_char_next(&led.line_prep.lstr, &i);
-            led_u8s_app_char(&led.line_write.lstr, c);
+        size_t i = led.line_prep->zone_start;
+        while (i < led.line_prep->zone_stop) {
+            led_u8s_char_next(&led.line_prep->lstr, &i);
+            led_u8s_app_char(&led.line_write->lstr, c);
         }
     }
 
@@ -821,13 +1078,13 @@ void led_fn_impl_generate(led_fn_t* pfunc) {
 }
 
 led_fn_desc_t LED_FN_TABLE[] = {
-    { "s", "substitute", &led_fn_impl_substitute, "Ss", "Substitute", "s/[regex]/replace[/opts]" },
+    { "s", "substitute", &led_fn_impl_substitute, "To", "Substitute", "s/[regex]/replace[/opts]" },
     { "d", "delete", &led_fn_impl_delete, "", "Delete line", "d/" },
-    { "i", "insert", &led_fn_impl_insert, "Sp", "Insert line", "i/[regex]/<string>[/N]" },
-    { "a", "append", &led_fn_impl_append, "Sp", "Append line", "a/[regex]/<string>[/N]" },
+    { "i", "insert", &led_fn_impl_insert, "Tp", "Insert line", "i/[regex]/<string>[/N]" },
+    { "a", "append", &led_fn_impl_append, "Tp", "Append line", "a/[regex]/<string>[/N]" },
     { "j", "join", &led_fn_impl_join, "", "Join lines (only with pack mode)", "j/" },
     { "db", "delete_blank", &led_fn_impl_delete_blank, "", "Delete blank/empty lines", "db/" },
-    { "tr", "translate", &led_fn_impl_translate, "SS", "Translate", "tr/[regex]/chars/chars" },
+    { "tr", "translate", &led_fn_impl_translate, "Mss", "Translate, delete (d) or squeeze (s) chars", "tr/[regex]/chars/chars[/opts]" },
     { "cl", "case_lower", &led_fn_impl_case_lower, "", "Case to lower", "cl/[regex]" },
     { "cu", "case_upper", &led_fn_impl_case_upper, "", "Case to upper", "cu/[regex]" },
     { "cf", "case_first", &led_fn_impl_case_first, "", "Case first upper", "cf/[regex]" },
@@ -837,7 +1094,7 @@ led_fn_desc_t LED_FN_TABLE[] = {
     { "qtd", "quote_double", &led_fn_impl_quote_double, "", "Quote double", "qd/[regex]" },
     { "qtb", "quote_back", &led_fn_impl_quote_back, "", "Quote back", "qb/[regex]" },
     { "qtr", "quote_remove", &led_fn_impl_quote_remove, "", "Quote remove", "qr/[regex]" },
-    { "sp", "split", &led_fn_impl_split, "S", "Split using characters", "sp/[regex]/chars" },
+    { "sp", "split", &led_fn_impl_split, "C", "Split using characters", "sp/[regex]/chars" },
     { "spc", "split_csv", &led_fn_impl_split_csv, "", "Split using comma", "spc/[regex]" },
     { "sps", "split_space", &led_fn_impl_split_space, "", "Split using space", "sps/[regex]" },
     { "spm", "split_mixed", &led_fn_impl_split_mixed, "", "Split using comma and space", "spm/[regex]" },
@@ -845,15 +1102,22 @@ led_fn_desc_t LED_FN_TABLE[] = {
     { "tml", "trim_left", &led_fn_impl_trim_left, "", "Trim left", "tml/[regex]" },
     { "tmr", "trim_right", &led_fn_impl_trim_right, "", "Trim right", "tmr/[regex]" },
     { "rv", "revert", &led_fn_impl_revert, "", "Revert", "rv/[regex]" },
-    { "fld", "field", &led_fn_impl_field, "PSp", "Extract field with separator chars", "fld/[regex]/N/sep[/count]" },
+    { "fld", "field", &led_fn_impl_field, "PCp", "Extract field with separator chars", "fld/[regex]/N/sep[/count]" },
+    { "cut", "field_cut", &led_fn_impl_field_cut, "Lcs", "Extract a list of fields (1,3,5-7)", "cut/[regex]/list[/sep[/outsep]]" },
     { "fls", "field_space", &led_fn_impl_field_space, "Pp", "Extract field separated by space", "fls/[regex]/N[/count]" },
     { "flc", "field_csv", &led_fn_impl_field_csv, "Pp", "Extract field separated by comma", "flc/[regex]/N[/count]" },
     { "flm", "field_mixed", &led_fn_impl_field_mixed, "Pp", "Extract field separated by space or comma", "flm/[regex]/N[/count]" },
-    { "b64e", "base64_encode", &led_fn_impl_base64_encode, "", "Encode base64", "b64e/[regex]" },
+    { "b64e", "base64_encode", &led_fn_impl_base64_encode, "b", "Encode base64, URL-safe (u) or without padding (n)", "b64e/[regex][/opts]" },
     { "b64d", "base64_decode", &led_fn_impl_base64_decode, "", "Decode base64", "b64d/[regex]" },
+    { "hash", "hash", &led_fn_impl_hash, "Hs", "Hash with crc32c, xxh3 or sha256, in hex, b64 or b64u", "hash/[regex]/algo[/enc]" },
     { "urle", "url_encode", &led_fn_impl_url_encode, "", "Encode URL", "urle/[regex]" },
+    { "urld", "url_decode", &led_fn_impl_url_decode, "", "Decode URL", "urld/[regex]" },
     { "she", "shell_escape", &led_fn_impl_shell_escape, "", "Shell escape", "she/[regex]" },
     { "shu", "shell_unescape", &led_fn_impl_shell_unescape, "", "Shell un-escape", "shu/[regex]" },
+    { "cse", "c_escape", &led_fn_impl_c_escape, "", "C string escape", "cse/[regex]" },
+    { "csu", "c_unescape", &led_fn_impl_c_unescape, "", "C string un-escape", "csu/[regex]" },
+    { "jse", "json_escape", &led_fn_impl_json_escape, "", "JSON string escape", "jse/[regex]" },
+    { "jsu", "json_unescape", &led_fn_impl_json_unescape, "", "JSON string un-escape", "jsu/[regex]" },
     { "rp", "realpath", &led_fn_impl_realpath, "", "Convert to real path (canonical)", "rp/[regex]" },
     { "dn", "dirname", &led_fn_impl_dirname, "", "Extract last dir of the path", "dn/[regex]" },
     { "bn", "basename", &led_fn_impl_basename, "", "Extract file of the path", "bn/[regex]" },
@@ -883,3 +1147,9 @@ led_fn_desc_t* led_fn_table_descriptor(size_t id) {
 size_t led_fn_table_size() {
     return LED_FN_TABLE_MAX;
 }
+
+bool led_fn_isstateless(led_fn_t* pfunc) {
+    // registers keep values from one line to the next ones
+    led_fn_impl impl = led_fn_table_descriptor(pfunc->id)->impl;
+    return impl != &led_fn_impl_register && impl != &led_fn_impl_register_recall;
+}
@@ -0,0 +1,249 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+
+#define _GNU_SOURCE
+#include "led.h"
+
+//-----------------------------------------------
+// LED grep mode
+//-----------------------------------------------
+
+// inline options, verbs and alternatives are not analysed, no prefilter
+static bool led_grep_isplain(const char* pat) {
+    for (const char* p = pat; *p; p++) {
+        if (*p == '\\' && p[1]) p++;
+        else if (*p == '|') return false;
+        else if (*p == '(' && p[1] == '*') return false;
+        else if (*p == '(' && p[1] == '?' && (isalpha((unsigned char)p[2]) || p[2] == '-' || p[2] == '^')) return false;
+    }
+    return true;
+}
+
+static size_t led_grep_unit_drop(const char* run, size_t len) {
+    // an optional char is removed from the run with all its UTF-8 bytes
+    while (len > 0 && ((unsigned char)run[len-1] & 0xC0) == 0x80) len--;
+    return len > 0 ? len - 1 : 0;
+}
+
+static const char* led_grep_escape_skip(const char* p) {
+    // p is on the escape letter, the escapes with an argument are moved to its last char
+    const char* arg = p + 1;
+    char close = *arg == '{' ? '}' : *arg == '<' ? '>' : *arg == '\'' ? '\'' : '\0';
+    if (close == '}' && strchr("xopPgk", *p) == NULL && !(*p == 'N' && strncmp(arg, "{U+", 3) == 0)) close = '\0';
+    if (close != '}' && *p != 'g' && *p != 'k') close = '\0';
+    if (close && strchr(arg + 1, close) != NULL) return strchr(arg + 1, close);
+
+    if (*p == 'c' && *arg) return arg;
+    if ((*p == 'p' || *p == 'P') && isalpha((unsigned char)*arg)) return arg;
+    if (*p == 'x') {
+        for (int n = 0; n < 2 && isxdigit((unsigned char)p[1]); n++) p++;
+        return p;
+    }
+    if (*p == 'g' && (*arg == '-' || *arg == '+')) p++;
+    if (*p == 'g' || isdigit((unsigned char)*p))
+        while (isdigit((unsigned char)p[1])) p++;
+    return p;
+}
+
+// extract the longest literal required by any match (outside of groups)
+size_t led_grep_literal(const char* pat, char* lit, size_t max) {
+    char run[LED_GREP_LIT_MAX];
+    size_t run_len = 0;
+    size_t lit_len = 0;
+    int depth = 0;
+
+    for (const char* p = pat; ; p++) {
+        bool optional = false;
+        if (*p == '\\' && p[1] == 'Q') {
+            // quoted text is literal up to \E, the run ends when it is full
+            bool full = false;
+            for (p += 2; *p && !(*p == '\\' && p[1] == 'E'); p++) {
+                if (depth == 0 && run_len < max - 1) run[run_len++] = *p;
+                else full = true;
+            }
+            if (*p && !full) {
+                p++;
+                continue;
+            }
+            if (*p) p++;
+        }
+        else if (*p == '\\' && p[1] && !isalnum((unsigned char)p[1])) {
+            p++;
+            if (depth == 0 && run_len < max - 1) {
+                run[run_len++] = *p;
+                continue;
+            }
+        }
+        else if (*p == '\\' && p[1]) {
+            // escape classes, codes and references
+            p = led_grep_escape_skip(p + 1);
+        }
+        else if (*p == '[') {
+            if (p[1] == '^') p++;
+            if (p[1] == ']') p++;
+            for (p++; *p && *p != ']'; p++) {
+                if (*p == '\\' && p[1] == 'Q') p = strstr(p, "\\E") != NULL ? strstr(p, "\\E") + 1 : p + strlen(p) - 1;
+                else if (*p == '\\' && p[1]) p++;
+                else if (*p == '[' && p[1] == ':' && strstr(p, ":]") != NULL) p = strstr(p, ":]") + 1;
+            }
+            if (*p == '\0') p--;
+        }
+        else if (*p == '(') depth++;
+        else if (*p == ')') depth--;
+        else if (*p == '?' || *p == '*') optional = true;
+        else if (*p == '{') {
+            // a quantifier {n}, {n,} or {n,m}, any other brace only ends the run
+            const char* q = p + 1;
+            while (isdigit((unsigned char)*q) || *q == ',') q++;
+            if (*q == '}' && q > p + 1) {
+                optional = true;
+                p = q;
+            }
+        }
+        else if (*p && strchr("+.^$}", *p) == NULL) {
+            if (depth == 0 && run_len < max - 1) {
+                run[run_len++] = *p;
+                continue;
+            }
+        }
+        // the run ends, an optional last char is not required
+        if (optional) run_len = led_grep_unit_drop(run, run_len);
+        if (run_len > lit_len) {
+            memcpy(lit, run, run_len);
+            lit_len = run_len;
+        }
+        run_len = 0;
+        if (*p == '\0') break;
+    }
+    lit[lit_len] = '\0';
+    return lit_len;
+}
+
+static int led_grep_unit(pcre2_code* code, uint32_t what_type, uint32_t what_unit) {
+    uint32_t type = 0;
+    uint32_t unit = 0;
+    if (pcre2_pattern_info(code, what_type, &type) != 0 || type != 1) return -1;
+    pcre2_pattern_info(code, what_unit, &unit);
+    // a caseless unit ([Yy]) is given in one case only, the units with other cases are not searched
+    return unit < 0x80 && !isalpha((int)unit) ? (int)unit : -1;
+}
+
+void led_grep_init() {
+    led.grep.enabled = led.func_count == 0
+        && !led.opt.exec
+        && !led.opt.pack_selected
+        && !led.opt.filter_blank
+        && led.sel.type_start == SEL_TYPE_REGEX
+        && led.sel.type_stop == SEL_TYPE_NONE
+        && led.sel.val_start == 0;
+    led.grep.unit = -1;
+    led.grep.lit_len = 0;
+    if (!led.grep.enabled) return;
+
+    led_regex_t* regex = led.sel.regex_start;
+    uint32_t options = 0;
+    pcre2_pattern_info(regex->code, PCRE2_INFO_ALLOPTIONS, &options);
+    if ((options & (PCRE2_CASELESS|PCRE2_EXTENDED)) || !led_grep_isplain(regex->pattern)) {
+        led_debug("Grep mode: no prefilter");
+        return;
+    }
+    led.grep.lit_len = led_grep_literal(regex->pattern, led.grep.lit, LED_GREP_LIT_MAX);
+
+    led.grep.unit = led_grep_unit(regex->code, PCRE2_INFO_FIRSTCODETYPE, PCRE2_INFO_FIRSTCODEUNIT);
+    if (led.grep.unit < 0)
+        led.grep.unit = led_grep_unit(regex->code, PCRE2_INFO_LASTCODETYPE, PCRE2_INFO_LASTCODEUNIT);
+    if (led.grep.unit < 0 && led.grep.lit_len > 0)
+        led.grep.unit = (unsigned char)led.grep.lit[0];
+    led_debug("Grep mode: literal (%s) unit (%d)", led.grep.lit, led.grep.unit);
+}
+
+static const char* led_grep_find(const char* str, size_t len) {
+    // glibc memmem and memchr are vectorized
+    if (led.grep.lit_len > 1)
+        return memmem(str, len, led.grep.lit, led.grep.lit_len);
+    if (led.grep.unit >= 0)
+        return memchr(str, led.grep.unit, len);
+    return len > 0 ? str : NULL;
+}
+
+static void led_grep_write(const char* str, size_t len) {
+    led_file_write(str, len);
+    if (str[len-1] != '\n')
+        led_file_write("\n", 1);
+    // the written block holds only selected lines, counted for the report
+    if (!led.opt.report) return;
+    size_t count = 0;
+    for (const char* nl = str; (nl = memchr(nl, '\n', str + len - nl)) != NULL; nl++)
+        count++;
+    if (str[len-1] != '\n') count++;
+    led.report.line_match_count += count;
+    led.report.file_line_match_count += count;
+}
+
+static void led_grep_lines(const char* str, size_t len) {
+    const char* stop = str + len;
+    const char* pos = str;
+    while (pos < stop) {
+        // lines before the candidate can not match
+        const char* hit = led_grep_find(pos, stop - pos);
+        const char* line = stop;
+        if (hit != NULL) {
+            const char* nl = memrchr(pos, '\n', hit - pos);
+            line = nl != NULL ? nl + 1 : pos;
+        }
+        if (led.opt.invert_selected && line > pos)
+            led_grep_write(pos, line - pos);
+        if (hit == NULL)
+            break;
+
+        const char* eol = memchr(hit, '\n', stop - hit);
+        const char* next = eol != NULL ? eol + 1 : stop;
+        size_t line_len = (eol != NULL ? eol : stop) - line;
+        if ((led_regex_match(led.sel.regex_start, line, line_len) > 0) != led.opt.invert_selected)
+            led_grep_write(line, next - line);
+        pos = next;
+    }
+}
+
+void led_process_grep() {
+    led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "led_process_grep");
+    led_reader_t* preader = &led.file_in.reader;
+    for (;;) {
+        // only whole lines are searched, a partial last line waits for the next block
+        char* start = preader->data + preader->pos;
+        size_t avail = preader->len - preader->pos;
+        char* end = preader->eof ? start + avail : avail > 0 ? memrchr(start, '\n', avail) : NULL;
+        if (end == NULL) {
+            led_reader_fill(preader);
+            continue;
+        }
+        if (!preader->eof) end++;
+        // the whole block is one selector stage
+        if (!led.opt.binary && !led_reader_check_block(preader, start, end - start))
+            break;
+        uint64_t stat_start = led_stat_begin(LED_STAT_SEL);
+        led_grep_lines(start, end - start);
+        led_stat_end(LED_STAT_SEL, stat_start, end - start, 0);
+        preader->pos += end - start;
+        preader->scan = 0;
+        if (preader->eof && preader->pos == preader->len)
+            break;
+    }
+}
@@ -0,0 +1,477 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+#include "led.h"
+
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LED_HASH_SIMD
+#endif
+
+//-----------------------------------------------
+// LED hash functions
+// The digest of a buffer of any size (a whole packed block is hashed in place),
+// the kernels using the CPU extensions are selected at runtime.
+//-----------------------------------------------
+
+static inline uint32_t led_hash_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t led_hash_read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static inline void led_hash_write_be(uint8_t* digest, uint64_t v, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        digest[i] = v >> (8 * (size - 1 - i));
+}
+
+//-----------------------------------------------
+// LED hash crc32c
+// Castagnoli polynomial, by the SSE4.2 crc32 instruction or a table of 256 entries.
+//-----------------------------------------------
+
+static uint32_t led_crc32c_table[256];
+static pthread_once_t led_crc32c_once = PTHREAD_ONCE_INIT;
+
+static void led_crc32c_init() {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+        led_crc32c_table[i] = c;
+    }
+}
+
+static uint32_t led_crc32c_scalar(uint32_t crc, const uint8_t* src, size_t len) {
+    pthread_once(&led_crc32c_once, &led_crc32c_init);
+    for (size_t i = 0; i < len; i++)
+        crc = led_crc32c_table[(crc ^ src[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef LED_HASH_SIMD
+
+__attribute__((target("sse4.2")))
+static uint32_t led_crc32c_sse42(uint32_t crc, const uint8_t* src, size_t len) {
+    size_t i = 0;
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+    for (; i + 8 <= len; i += 8)
+        crc64 = _mm_crc32_u64(crc64, led_hash_read64(src + i));
+    crc = crc64;
+#endif
+    for (; i < len; i++)
+        crc = _mm_crc32_u8(crc, src[i]);
+    return crc;
+}
+
+#endif
+
+static uint32_t led_crc32c(const uint8_t* src, size_t len) {
+#ifdef LED_HASH_SIMD
+    if (__builtin_cpu_supports("sse4.2")) return ~led_crc32c_sse42(~0U, src, len);
+#endif
+    return ~led_crc32c_scalar(~0U, src, len);
+}
+
+//-----------------------------------------------
+// LED hash xxh3
+// XXH3 64 bits without seed and with the default secret. The long inputs are
+// accumulated by stripes of 64 bytes on 8 lanes (AVX2, SSE2 or scalar).
+//-----------------------------------------------
+
+#define LED_XXH_PRIME32_1 0x9E3779B1U
+#define LED_XXH_PRIME32_2 0x85EBCA77U
+#define LED_XXH_PRIME32_3 0xC2B2AE3DU
+#define LED_XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define LED_XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define LED_XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define LED_XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define LED_XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define LED_XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define LED_XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define LED_XXH_STRIPE_LEN 64
+#define LED_XXH_SECRET_SIZE 192
+#define LED_XXH_SECRET_RATE 8
+#define LED_XXH_STRIPES_PER_BLOCK ((LED_XXH_SECRET_SIZE - LED_XXH_STRIPE_LEN) / LED_XXH_SECRET_RATE)
+
+static const uint8_t led_xxh3_secret[LED_XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static inline uint64_t led_xxh_rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t led_xxh_mul128_fold64(uint64_t lhs, uint64_t rhs) {
+    __uint128_t product = (__uint128_t)lhs * rhs;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static inline uint64_t led_xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= LED_XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= LED_XXH_PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t led_xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= LED_XXH_PRIME_MX1;
+    return h ^ (h >> 32);
+}
+
+static inline uint64_t led_xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= led_xxh_rotl64(h, 49) ^ led_xxh_rotl64(h, 24);
+    h *= LED_XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= LED_XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static inline uint64_t led_xxh3_mix16(const uint8_t* src, const uint8_t* secret) {
+    return led_xxh_mul128_fold64(led_hash_read64(src) ^ led_hash_read64(secret),
+        led_hash_read64(src + 8) ^ led_hash_read64(secret + 8));
+}
+
+static uint64_t led_xxh3_short(const uint8_t* src, size_t len) {
+    const uint8_t* secret = led_xxh3_secret;
+    if (len > 8) {
+        uint64_t lo = led_hash_read64(src) ^ (led_hash_read64(secret + 24) ^ led_hash_read64(secret + 32));
+        uint64_t hi = led_hash_read64(src + len - 8) ^ (led_hash_read64(secret + 40) ^ led_hash_read64(secret + 48));
+        return led_xxh3_avalanche(len + __builtin_bswap64(lo) + hi + led_xxh_mul128_fold64(lo, hi));
+    }
+    if (len >= 4) {
+        uint64_t in = led_hash_read32(src + len - 4) + ((uint64_t)led_hash_read32(src) << 32);
+        return led_xxh3_rrmxmx(in ^ (led_hash_read64(secret + 8) ^ led_hash_read64(secret + 16)), len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t)src[0] << 16) | ((uint32_t)src[len >> 1] << 24) | src[len - 1] | ((uint32_t)len << 8);
+        return led_xxh64_avalanche(combined ^ (uint64_t)(led_hash_read32(secret) ^ led_hash_read32(secret + 4)));
+    }
+    return led_xxh64_avalanche(led_hash_read64(secret + 56) ^ led_hash_read64(secret + 64));
+}
+
+static uint64_t led_xxh3_medium(const uint8_t* src, size_t len) {
+    const uint8_t* secret = led_xxh3_secret;
+    uint64_t acc = len * LED_XXH_PRIME64_1;
+    if (len <= 128) {
+        // pairs of 16 bytes from both ends
+        for (size_t i = 0; i <= (len - 1) / 32; i++) {
+            acc += led_xxh3_mix16(src + 16 * i, secret + 32 * i);
+            acc += led_xxh3_mix16(src + len - 16 * (i + 1), secret + 32 * i + 16);
+        }
+        return led_xxh3_avalanche(acc);
+    }
+    for (size_t i = 0; i < 8; i++)
+        acc += led_xxh3_mix16(src + 16 * i, secret + 16 * i);
+    acc = led_xxh3_avalanche(acc);
+    uint64_t acc_end = led_xxh3_mix16(src + len - 16, secret + 136 - 17);
+    for (size_t i = 8; i < len / 16; i++)
+        acc_end += led_xxh3_mix16(src + 16 * i, secret + 16 * (i - 8) + 3);
+    return led_xxh3_avalanche(acc + acc_end);
+}
+
+typedef void (*led_xxh3_acc_fn)(uint64_t* acc, const uint8_t* src, const uint8_t* secret, size_t stripes);
+typedef void (*led_xxh3_scramble_fn)(uint64_t* acc, const uint8_t* secret);
+
+static void led_xxh3_acc_scalar(uint64_t* acc, const uint8_t* src, const uint8_t* secret, size_t stripes) {
+    for (size_t n = 0; n < stripes; n++, src += LED_XXH_STRIPE_LEN, secret += LED_XXH_SECRET_RATE) {
+        for (size_t i = 0; i < 8; i++) {
+            uint64_t data = led_hash_read64(src + 8 * i);
+            uint64_t key = data ^ led_hash_read64(secret + 8 * i);
+            acc[i ^ 1] += data;
+            acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+        }
+    }
+}
+
+static void led_xxh3_scramble_scalar(uint64_t* acc, const uint8_t* secret) {
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= led_hash_read64(secret + 8 * i);
+        acc[i] = a * LED_XXH_PRIME32_1;
+    }
+}
+
+#ifdef LED_HASH_SIMD
+
+__attribute__((target("avx2")))
+static void led_xxh3_acc_avx2(uint64_t* acc, const uint8_t* src, const uint8_t* secret, size_t stripes) {
+    __m256i xacc[2] = { _mm256_loadu_si256((const __m256i*)acc), _mm256_loadu_si256((const __m256i*)(acc + 4)) };
+    for (size_t n = 0; n < stripes; n++, src += LED_XXH_STRIPE_LEN, secret += LED_XXH_SECRET_RATE) {
+        for (size_t i = 0; i < 2; i++) {
+            __m256i data = _mm256_loadu_si256((const __m256i*)src + i);
+            __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret + i));
+            __m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+            __m256i swap = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm256_add_epi64(product, _mm256_add_epi64(xacc[i], swap));
+        }
+    }
+    _mm256_storeu_si256((__m256i*)acc, xacc[0]);
+    _mm256_storeu_si256((__m256i*)(acc + 4), xacc[1]);
+}
+
+__attribute__((target("avx2")))
+static void led_xxh3_scramble_avx2(uint64_t* acc, const uint8_t* secret) {
+    const __m256i prime = _mm256_set1_epi32((int)LED_XXH_PRIME32_1);
+    for (size_t i = 0; i < 2; i++) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)acc + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256((const __m256i*)secret + i));
+        __m256i lo = _mm256_mul_epu32(a, prime);
+        __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        _mm256_storeu_si256((__m256i*)acc + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+static void led_xxh3_acc_sse2(uint64_t* acc, const uint8_t* src, const uint8_t* secret, size_t stripes) {
+    __m128i xacc[4];
+    for (size_t i = 0; i < 4; i++)
+        xacc[i] = _mm_loadu_si128((const __m128i*)acc + i);
+    for (size_t n = 0; n < stripes; n++, src += LED_XXH_STRIPE_LEN, secret += LED_XXH_SECRET_RATE) {
+        for (size_t i = 0; i < 4; i++) {
+            __m128i data = _mm_loadu_si128((const __m128i*)src + i);
+            __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret + i));
+            __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swap = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm_add_epi64(product, _mm_add_epi64(xacc[i], swap));
+        }
+    }
+    for (size_t i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i*)acc + i, xacc[i]);
+}
+
+static void led_xxh3_scramble_sse2(uint64_t* acc, const uint8_t* secret) {
+    const __m128i prime = _mm_set1_epi32((int)LED_XXH_PRIME32_1);
+    for (size_t i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)acc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)secret + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        _mm_storeu_si128((__m128i*)acc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
+
+static uint64_t led_xxh3_long(const uint8_t* src, size_t len) {
+    led_xxh3_acc_fn acc_fn = &led_xxh3_acc_scalar;
+    led_xxh3_scramble_fn scramble_fn = &led_xxh3_scramble_scalar;
+#ifdef LED_HASH_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        acc_fn = &led_xxh3_acc_avx2;
+        scramble_fn = &led_xxh3_scramble_avx2;
+    }
+    else {
+        acc_fn = &led_xxh3_acc_sse2;
+        scramble_fn = &led_xxh3_scramble_sse2;
+    }
+#endif
+    const uint8_t* secret = led_xxh3_secret;
+    uint64_t acc[8] = {
+        LED_XXH_PRIME32_3, LED_XXH_PRIME64_1, LED_XXH_PRIME64_2, LED_XXH_PRIME64_3,
+        LED_XXH_PRIME64_4, LED_XXH_PRIME32_2, LED_XXH_PRIME64_5, LED_XXH_PRIME32_1
+    };
+    const size_t block_len = LED_XXH_STRIPE_LEN * LED_XXH_STRIPES_PER_BLOCK;
+    const size_t blocks = (len - 1) / block_len;
+    for (size_t n = 0; n < blocks; n++) {
+        acc_fn(acc, src + n * block_len, secret, LED_XXH_STRIPES_PER_BLOCK);
+        scramble_fn(acc, secret + LED_XXH_SECRET_SIZE - LED_XXH_STRIPE_LEN);
+    }
+    // last partial block, then the last stripe (overlapping) with its own secret offset
+    acc_fn(acc, src + blocks * block_len, secret, ((len - 1) - block_len * blocks) / LED_XXH_STRIPE_LEN);
+    acc_fn(acc, src + len - LED_XXH_STRIPE_LEN, secret + LED_XXH_SECRET_SIZE - LED_XXH_STRIPE_LEN - 7, 1);
+
+    uint64_t result = len * LED_XXH_PRIME64_1;
+    for (size_t i = 0; i < 4; i++)
+        result += led_xxh_mul128_fold64(acc[2 * i] ^ led_hash_read64(secret + 11 + 16 * i),
+            acc[2 * i + 1] ^ led_hash_read64(secret + 11 + 16 * i + 8));
+    return led_xxh3_avalanche(result);
+}
+
+static uint64_t led_xxh3(const uint8_t* src, size_t len) {
+    if (len <= 16) return led_xxh3_short(src, len);
+    if (len <= 240) return led_xxh3_medium(src, len);
+    return led_xxh3_long(src, len);
+}
+
+//-----------------------------------------------
+// LED hash sha256
+// Blocks of 64 bytes compressed by the SHA extensions (2 rounds per instruction)
+// or by the portable rounds.
+//-----------------------------------------------
+
+static const uint32_t led_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t led_sha256_rotr(uint32_t v, int r) {
+    return (v >> r) | (v << (32 - r));
+}
+
+static void led_sha256_blocks_scalar(uint32_t* state, const uint8_t* src, size_t blocks) {
+    for (; blocks > 0; blocks--, src += 64) {
+        uint32_t w[64];
+        for (size_t i = 0; i < 16; i++)
+            w[i] = (uint32_t)src[4 * i] << 24 | (uint32_t)src[4 * i + 1] << 16 | (uint32_t)src[4 * i + 2] << 8 | src[4 * i + 3];
+        for (size_t i = 16; i < 64; i++) {
+            uint32_t s0 = led_sha256_rotr(w[i - 15], 7) ^ led_sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = led_sha256_rotr(w[i - 2], 17) ^ led_sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t i = 0; i < 64; i++) {
+            uint32_t t1 = h + (led_sha256_rotr(e, 6) ^ led_sha256_rotr(e, 11) ^ led_sha256_rotr(e, 25))
+                + ((e & f) ^ (~e & g)) + led_sha256_k[i] + w[i];
+            uint32_t t2 = (led_sha256_rotr(a, 2) ^ led_sha256_rotr(a, 13) ^ led_sha256_rotr(a, 22))
+                + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef LED_HASH_SIMD
+
+// the state is kept as ABEF and CDGH vectors, the message schedule on 4 rotating vectors
+__attribute__((target("sha,sse4.1")))
+static void led_sha256_blocks_ni(uint32_t* state, const uint8_t* src, size_t blocks) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, src += 64) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+        __m128i msg[4];
+        for (size_t i = 0; i < 16; i++) {
+            __m128i* cur = &msg[i & 3];
+            __m128i* next = &msg[(i + 1) & 3];
+            __m128i* prev = &msg[(i + 3) & 3];
+            if (i < 4) *cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 16 * i)), bswap);
+            __m128i wk = _mm_add_epi32(*cur, _mm_loadu_si128((const __m128i*)(led_sha256_k + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            if (i >= 3 && i <= 14) {
+                *next = _mm_add_epi32(*next, _mm_alignr_epi8(*cur, *prev, 4));
+                *next = _mm_sha256msg2_epu32(*next, *cur);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+            if (i >= 1 && i <= 12) *prev = _mm_sha256msg1_epu32(*prev, *cur);
+        }
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)state, state0);
+    _mm_storeu_si128((__m128i*)(state + 4), state1);
+}
+
+#endif
+
+static void led_sha256_blocks(uint32_t* state, const uint8_t* src, size_t blocks) {
+#ifdef LED_HASH_SIMD
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+        led_sha256_blocks_ni(state, src, blocks);
+        return;
+    }
+#endif
+    led_sha256_blocks_scalar(state, src, blocks);
+}
+
+static void led_sha256(const uint8_t* src, size_t len, uint8_t* digest) {
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    // the whole blocks in place, then the tail padded with the bit length
+    size_t blocks = len / 64;
+    led_sha256_blocks(state, src, blocks);
+    uint8_t tail[128] = { 0 };
+    size_t rest = len - blocks * 64;
+    memcpy(tail, src + blocks * 64, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest < 56 ? 64 : 128;
+    led_hash_write_be(tail + tail_len - 8, (uint64_t)len * 8, 8);
+    led_sha256_blocks(state, tail, tail_len / 64);
+    for (size_t i = 0; i < 8; i++)
+        led_hash_write_be(digest + 4 * i, state[i], 4);
+}
+
+//-----------------------------------------------
+// LED hash API
+//-----------------------------------------------
+
+size_t led_hash_digest(size_t algo, const char* src, size_t len, uint8_t* digest) {
+    const uint8_t* usrc = (const uint8_t*)src;
+    if (algo == LED_HASH_CRC32C) {
+        led_hash_write_be(digest, led_crc32c(usrc, len), 4);
+        return 4;
+    }
+    if (algo == LED_HASH_XXH3) {
+        led_hash_write_be(digest, led_xxh3(usrc, len), 8);
+        return 8;
+    }
+    led_sha256(usrc, len, digest);
+    return 32;
+}
@@ -0,0 +1,272 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include "led.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//-----------------------------------------------
+// LED input reader
+//-----------------------------------------------
+
+static void led_reader_alloc(led_reader_t* preader, size_t size) {
+    // the buffer is reused and only grows to the biggest block needed
+    if (size > preader->buf_size) {
+        size_t buf_size = preader->buf_size ? preader->buf_size : LED_READER_BUF_MAX;
+        while (buf_size < size) buf_size *= 2;
+        char* buf = realloc(preader->buf, buf_size);
+        led_assert(buf != NULL, LED_ERR_INTERNAL, "Input buffer allocation error (%lu)", buf_size);
+        preader->buf = buf;
+        preader->buf_size = buf_size;
+    }
+    preader->data = preader->buf;
+}
+
+void led_reader_open(led_reader_t* preader, int fd) {
+    struct stat st;
+    preader->fd = fd;
+    preader->len = 0;
+    preader->pos = 0;
+    preader->scan = 0;
+    preader->eof = false;
+    preader->valid = 0;
+    preader->ascii = true;
+    preader->offset = 0;
+
+    bool regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (regular && st.st_size > 0) {
+        if ((size_t)st.st_size >= LED_READER_MMAP_MIN) {
+            void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                preader->type = LED_READER_MMAP;
+                preader->map = preader->data = map;
+                preader->len = st.st_size;
+                preader->eof = true;
+                led_debug("Reader open: mmap (%lu)", preader->len);
+                return;
+            }
+        }
+        // small file loaded with one read into a buffer of the file size
+        preader->type = LED_READER_FILE;
+        led_reader_alloc(preader, st.st_size);
+        led_reader_fill(preader);
+        preader->eof = preader->len == (size_t)st.st_size;
+        led_debug("Reader open: file (%lu)", preader->len);
+    }
+    else if (regular) {
+        // empty file, or a special file without size read as a stream
+        preader->type = LED_READER_STREAM;
+        led_reader_alloc(preader, LED_READER_BUF_MAX);
+        led_reader_fill(preader);
+        if (preader->eof) preader->type = LED_READER_FILE;
+        led_debug("Reader open: %s (%lu)", preader->eof ? "file" : "stream", preader->len);
+    }
+    else {
+        preader->type = LED_READER_STREAM;
+        led_reader_alloc(preader, LED_READER_BUF_MAX);
+        led_debug("Reader open: stream");
+    }
+}
+
+void led_reader_open_mem(led_reader_t* preader, const char* data, size_t len) {
+    // the memory content is used as a single block, no copy
+    preader->type = LED_READER_MEM;
+    preader->fd = -1;
+    preader->data = (char*)data;
+    preader->len = len;
+    preader->pos = 0;
+    preader->scan = 0;
+    preader->eof = true;
+    preader->valid = 0;
+    preader->ascii = true;
+    preader->offset = 0;
+    led_debug("Reader open: memory (%lu)", len);
+}
+
+bool led_reader_fill(led_reader_t* preader) {
+    if (preader->eof) return false;
+
+    // keep the pending partial line at the block start
+    if (preader->pos > 0) {
+        preader->len -= preader->pos;
+        memmove(preader->buf, preader->buf + preader->pos, preader->len);
+        preader->valid = preader->valid > preader->pos ? preader->valid - preader->pos : 0;
+        preader->offset += preader->pos;
+        preader->pos = 0;
+    }
+    // line bigger than the block, grow it
+    if (preader->len == preader->buf_size) {
+        led_assert(led.arena.max == 0 || preader->len <= led.arena.max, LED_ERR_MAXLINE, "Line size exceeds the maximum of %lu bytes", led.arena.max);
+        led_reader_alloc(preader, preader->buf_size * 2);
+    }
+
+    ssize_t rc;
+    do rc = read(preader->fd, preader->buf + preader->len, preader->buf_size - preader->len);
+    while (rc < 0 && errno == EINTR);
+    led_assert(rc >= 0, LED_ERR_FILE, "File read error: %s", strerror(errno));
+
+    if (rc == 0) preader->eof = true;
+    preader->len += rc;
+    return rc > 0;
+}
+
+bool led_reader_check_block(led_reader_t* preader, const char* str, size_t len) {
+    size_t valid = led_u8s_valid_buf(str, len);
+    if (valid == len) return true;
+    led_file_invalid(preader->offset + (str - preader->data) + valid);
+    // the rest of the input is skipped
+    preader->pos = preader->len;
+    preader->scan = 0;
+    preader->eof = true;
+    return false;
+}
+
+bool led_reader_check_all(led_reader_t* preader) {
+    // a fully loaded input is checked at once, its lines are then not checked again
+    size_t ascii = led_u8s_ascii_buf(preader->data, preader->len);
+    preader->ascii = ascii == preader->len;
+    if (!preader->ascii && !led_reader_check_block(preader, preader->data + ascii, preader->len - ascii))
+        return false;
+    preader->valid = preader->len;
+    return true;
+}
+
+bool led_reader_check(led_reader_t* preader, led_u8s_t* lstr) {
+    // lines are checked by windows of whole lines, up to the block size
+    size_t start = lstr->str - preader->data;
+    size_t stop = start + lstr->len;
+    if (stop > preader->valid) {
+        size_t window = preader->len - start;
+        if (window > LED_READER_BUF_MAX || !preader->eof) {
+            // a partial line is never split, the window stops at a new line
+            if (window > LED_READER_BUF_MAX) window = LED_READER_BUF_MAX;
+            char* end = memrchr(preader->data + start, '\n', window);
+            window = end != NULL && (size_t)(end - preader->data) >= stop ? (size_t)(end - preader->data) - start : lstr->len;
+        }
+        size_t ascii = led_u8s_ascii_buf(preader->data + start, window);
+        if (ascii < window)
+            led_reader_check_block(preader, preader->data + start + ascii, window - ascii);
+        preader->ascii = ascii == window;
+        preader->valid = start + window;
+        led_trace(LED_TRACE_IO, LED_TRACE_DETAIL, "Reader check: %lu bytes (ascii: %d)", window, preader->ascii);
+    }
+    return preader->ascii || led_u8s_ascii_buf(lstr->str, lstr->len) == lstr->len;
+}
+
+void led_reader_close(led_reader_t* preader) {
+    if (preader->type == LED_READER_MMAP)
+        munmap(preader->map, preader->len);
+    preader->map = NULL;
+    preader->data = NULL;
+    preader->type = LED_READER_NONE;
+    preader->fd = -1;
+    preader->len = 0;
+    preader->pos = 0;
+    preader->scan = 0;
+}
+
+void led_reader_free(led_reader_t* preader) {
+    led_reader_close(preader);
+    free(preader->buf);
+    preader->buf = NULL;
+    preader->buf_size = 0;
+}
+
+//-----------------------------------------------
+// LED output writer
+//-----------------------------------------------
+
+static void led_writer_syswrite(led_writer_t* pwriter, const char* str, size_t len) {
+    while (len > 0) {
+        ssize_t rc = write(pwriter->fd, str, len);
+        if (rc < 0 && errno == EINTR) continue;
+        led_assert(rc >= 0, LED_ERR_FILE, "File write error: %s", strerror(errno));
+        str += rc;
+        len -= rc;
+    }
+}
+
+void led_writer_open(led_writer_t* pwriter, int fd, bool linebuf) {
+    // the buffer is allocated once and reused for all subsequent files
+    if (pwriter->buf == NULL) {
+        pwriter->buf = malloc(LED_WRITER_BUF_MAX);
+        led_assert(pwriter->buf != NULL, LED_ERR_INTERNAL, "Output buffer allocation error");
+        pwriter->size = LED_WRITER_BUF_MAX;
+    }
+    pwriter->fd = fd;
+    pwriter->len = 0;
+    pwriter->linebuf = linebuf;
+    pwriter->mem = false;
+    led_debug("Writer open: fd=%d linebuf=%d", fd, linebuf);
+}
+
+void led_writer_open_mem(led_writer_t* pwriter) {
+    led_writer_open(pwriter, -1, false);
+    pwriter->mem = true;
+}
+
+void led_writer_flush(led_writer_t* pwriter) {
+    if (pwriter->len > 0 && pwriter->fd >= 0) {
+        led_writer_syswrite(pwriter, pwriter->buf, pwriter->len);
+        pwriter->len = 0;
+    }
+}
+
+void led_writer_direct(led_writer_t* pwriter, const char* str, size_t len) {
+    if (pwriter->mem) {
+        size_t size = pwriter->size;
+        while (size < pwriter->len + len) size *= 2;
+        char* buf = realloc(pwriter->buf, size);
+        led_assert(buf != NULL, LED_ERR_INTERNAL, "Output buffer allocation error (%lu)", size);
+        pwriter->buf = buf;
+        pwriter->size = size;
+        memcpy(pwriter->buf + pwriter->len, str, len);
+        pwriter->len += len;
+        return;
+    }
+    led_writer_flush(pwriter);
+    if (len >= pwriter->size)
+        led_writer_syswrite(pwriter, str, len);
+    else {
+        memcpy(pwriter->buf, str, len);
+        pwriter->len = len;
+        if (pwriter->linebuf && len > 0 && str[len-1] == '\n')
+            led_writer_flush(pwriter);
+    }
+}
+
+void led_writer_close(led_writer_t* pwriter) {
+    led_writer_flush(pwriter);
+    pwriter->fd = -1;
+}
+
+void led_writer_free(led_writer_t* pwriter) {
+    // the pending length is cleared first, a write error then frees again from led_assert() without looping
+    size_t len = pwriter->len;
+    pwriter->len = 0;
+    if (len > 0 && pwriter->fd >= 0)
+        led_writer_syswrite(pwriter, pwriter->buf, len);
+    free(pwriter->buf);
+    memset(pwriter, 0, sizeof *pwriter);
+    pwriter->fd = -1;
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+#include "led.h"
+
+#include <pthread.h>
+
+//-----------------------------------------------
+// LED library
+//-----------------------------------------------
+
+static pthread_once_t led_lib_once = PTHREAD_ONCE_INIT;
+
+static void led_lib_process() {
+    led_file_sel_reset();
+    led_line_reset(&led.line_read);
+    led_line_reset(led.line_prep);
+    led_line_reset(led.line_write);
+    led_process_lines();
+}
+
+int led_lib_compile(led_t** ppctx, int argc, const char* argv[]) {
+    led_t* pctx = calloc(1, sizeof *pctx);
+    *ppctx = pctx;
+    if (pctx == NULL)
+        return LED_ERR_INTERNAL;
+
+    // the shared regex are compiled once for all the contexts
+    pthread_once(&led_lib_once, led_regex_init);
+
+    // arguments are cut in place by the parser, the context keeps its own copy
+    pctx->lib.argc = argc + 1;
+    pctx->lib.argv = calloc(argc + 2, sizeof *pctx->lib.argv);
+    if (pctx->lib.argv == NULL)
+        return LED_ERR_INTERNAL;
+    pctx->lib.argv[0] = strdup("led");
+    for (int i = 0; i < argc; i++)
+        pctx->lib.argv[i + 1] = strdup(argv[i]);
+
+    led_t* pctx_caller = led_ctx;
+    led_ctx = pctx;
+    jmp_buf jmp;
+    int rc = setjmp(jmp);
+    if (rc == 0) {
+        led.lib.jmp = &jmp;
+        led_init(led.lib.argc, led.lib.argv);
+    }
+    led.lib.jmp = NULL;
+    led_ctx = pctx_caller;
+    return rc;
+}
+
+int led_lib_run_buf(led_t* pctx, const char* in, size_t in_len, const char** pout, size_t* pout_len) {
+    led_t* pctx_caller = led_ctx;
+    led_ctx = pctx;
+    jmp_buf jmp;
+    int rc = setjmp(jmp);
+    if (rc == 0) {
+        led.lib.jmp = &jmp;
+        led_reader_open_mem(&led.file_in.reader, in, in_len);
+        led_writer_open_mem(&led.file_out.writer);
+        led_lib_process();
+    }
+    // the output stays in the context writer buffer until the next run
+    *pout = led.file_out.writer.buf;
+    *pout_len = led.file_out.writer.len;
+    led_reader_close(&led.file_in.reader);
+    led.lib.jmp = NULL;
+    led_ctx = pctx_caller;
+    return rc;
+}
+
+int led_lib_run_fd(led_t* pctx, int fd_in, int fd_out) {
+    led_t* pctx_caller = led_ctx;
+    led_ctx = pctx;
+    jmp_buf jmp;
+    int rc = setjmp(jmp);
+    if (rc == 0) {
+        led.lib.jmp = &jmp;
+        led_reader_open(&led.file_in.reader, fd_in);
+        led_writer_open(&led.file_out.writer, fd_out, false);
+        led_lib_process();
+        led_writer_flush(&led.file_out.writer);
+    }
+    led.file_out.writer.len = 0;
+    led.file_out.writer.fd = -1;
+    led_reader_close(&led.file_in.reader);
+    led.lib.jmp = NULL;
+    led_ctx = pctx_caller;
+    return rc;
+}
+
+const char* led_lib_message(led_t* pctx) {
+    return (const char*)pctx->buf_message;
+}
+
+void led_lib_free(led_t* pctx) {
+    if (pctx == NULL)
+        return;
+    led_t* pctx_caller = led_ctx;
+    led_ctx = pctx;
+    led_free();
+    for (int i = 0; led.lib.argv && i < led.lib.argc; i++)
+        free(led.lib.argv[i]);
+    free(led.lib.argv);
+    led_ctx = pctx_caller;
+    free(pctx);
+}
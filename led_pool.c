@@ -0,0 +1,400 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+#include "led.h"
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+//-----------------------------------------------
+// LED worker pool
+//-----------------------------------------------
+
+typedef struct {
+    char* name;
+    char* name_out;
+    off_t size;
+    bool done;
+} led_pool_task_t;
+
+typedef struct {
+    char* buf;
+    size_t buf_size;
+    const char* data;
+    size_t len;
+    led_writer_t writer;
+    size_t match_count;
+    bool ascii;
+    bool done;
+} led_pool_chunk_t;
+
+// the pool state is shared by the workers and only accessed with the lock
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    pthread_cond_t done;
+    led_t* workers;
+    pthread_t* threads;
+    size_t nworker;
+    bool closed;
+    // file tasks
+    led_pool_task_t* tasks;
+    size_t task_count;
+    size_t task_size;
+    size_t* todo;
+    size_t todo_pos;
+    size_t print_pos;
+    // chunk ring, chunks are written in input order
+    led_pool_chunk_t* chunks;
+    size_t nchunk;
+    size_t chunk_todo;
+    size_t chunk_submit;
+    size_t chunk_write;
+} led_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER
+};
+
+static void led_pool_start(void* (*worker_fn)(void*)) {
+    led_pool.nworker = led.opt.jobs;
+    led_pool.workers = calloc(led_pool.nworker, sizeof *led_pool.workers);
+    led_pool.threads = calloc(led_pool.nworker, sizeof *led_pool.threads);
+    led_assert(led_pool.workers != NULL && led_pool.threads != NULL, LED_ERR_INTERNAL, "Worker pool allocation error (%lu)", led_pool.nworker);
+    led_pool.closed = false;
+    led_debug("Worker pool start: %lu workers", led_pool.nworker);
+
+    for (size_t i = 0; i < led_pool.nworker; i++) {
+        // a worker shares the compiled configuration and owns all the runtime state
+        led_t* pworker = &led_pool.workers[i];
+        *pworker = led;
+        memset(&pworker->report, 0, sizeof pworker->report);
+        memset(&pworker->file_in, 0, sizeof pworker->file_in);
+        memset(&pworker->file_out, 0, sizeof pworker->file_out);
+        memset(&pworker->arena, 0, sizeof pworker->arena);
+        pworker->stdin_ispipe = false;
+        pworker->worker.id = i + 1;
+        led_ctx = pworker;
+        led_init_runtime();
+        led_ctx = &led_main;
+        int rc = pthread_create(&led_pool.threads[i], NULL, worker_fn, pworker);
+        led_assert(rc == 0, LED_ERR_INTERNAL, "Worker thread creation error (%d)", rc);
+    }
+}
+
+static void led_pool_stop() {
+    pthread_mutex_lock(&led_pool.lock);
+    led_pool.closed = true;
+    pthread_cond_broadcast(&led_pool.ready);
+    pthread_mutex_unlock(&led_pool.lock);
+
+    for (size_t i = 0; i < led_pool.nworker; i++) {
+        pthread_join(led_pool.threads[i], NULL);
+        led_report_merge(&led_pool.workers[i]);
+    }
+    led_debug("Worker pool stop");
+    free(led_pool.threads);
+    free(led_pool.workers);
+    led_pool.threads = NULL;
+    led_pool.workers = NULL;
+}
+
+bool led_pool_isready() {
+    // workers are independent when each input file has its own output file
+    return led.opt.file_in
+        && !led.opt.exec
+        && (led.opt.file_out == LED_OUTPUT_FILE_INPLACE
+            || led.opt.file_out == LED_OUTPUT_FILE_NEWEXT
+            || led.opt.file_out == LED_OUTPUT_FILE_DIR);
+}
+
+bool led_pool_isstateless() {
+    // chunks of a stream are independent when each line is processed alone
+    const char* reason = NULL;
+    if (led.sel.type_start == SEL_TYPE_COUNT)
+        reason = "the selector uses line numbers";
+    else if (led.sel.type_stop != SEL_TYPE_NONE || led.sel.val_start > 0)
+        reason = "the selector selects ranges of lines";
+    else if (led.opt.pack_selected)
+        reason = "the selected lines are packed";
+    else if (led.opt.exec)
+        reason = "the lines are executed";
+    for (size_t i = 0; !reason && i < led.func_count; i++)
+        if (!led_fn_isstateless(&led.func_list[i]))
+            reason = "a register function keeps values between lines";
+    if (reason)
+        led_debug("Jobs option ignored, the input is processed serially: %s", reason);
+    return reason == NULL;
+}
+
+//-----------------------------------------------
+// LED worker pool: one file per worker
+//-----------------------------------------------
+
+static int led_pool_cmp_size(const void* pa, const void* pb) {
+    const led_pool_task_t* ptask_a = &led_pool.tasks[*(const size_t*)pa];
+    const led_pool_task_t* ptask_b = &led_pool.tasks[*(const size_t*)pb];
+    if (ptask_a->size != ptask_b->size)
+        return ptask_a->size < ptask_b->size ? 1 : -1;
+    return *(const size_t*)pa < *(const size_t*)pb ? -1 : 1;
+}
+
+static void led_pool_print_task(led_pool_task_t* ptask) {
+    if (ptask->name_out) {
+        fwrite(ptask->name_out, 1, strlen(ptask->name_out), stdout);
+        fwrite("\n", 1, 1, stdout);
+        free(ptask->name_out);
+        ptask->name_out = NULL;
+    }
+    free(ptask->name);
+    ptask->name = NULL;
+}
+
+static void led_pool_add(led_pool_task_t* batch, size_t count) {
+    pthread_mutex_lock(&led_pool.lock);
+    if (led_pool.task_count + count > led_pool.task_size) {
+        size_t task_size = led_pool.task_size ? led_pool.task_size : LED_POOL_BATCH;
+        while (task_size < led_pool.task_count + count) task_size *= 2;
+        led_pool.tasks = realloc(led_pool.tasks, task_size * sizeof *led_pool.tasks);
+        led_pool.todo = realloc(led_pool.todo, task_size * sizeof *led_pool.todo);
+        led_assert(led_pool.tasks != NULL && led_pool.todo != NULL, LED_ERR_INTERNAL, "Worker pool allocation error (%lu)", task_size);
+        led_pool.task_size = task_size;
+    }
+    size_t first = led_pool.task_count;
+    for (size_t i = 0; i < count; i++) {
+        led_pool.tasks[first + i] = batch[i];
+        led_pool.todo[first + i] = first + i;
+    }
+    led_pool.task_count += count;
+    // inside a batch the biggest files start first to balance the workers load
+    qsort(led_pool.todo + first, count, sizeof *led_pool.todo, led_pool_cmp_size);
+    pthread_cond_broadcast(&led_pool.ready);
+    pthread_mutex_unlock(&led_pool.lock);
+}
+
+static bool led_pool_read_name(led_u8s_t* fname) {
+    char buf_fname[LED_FNAME_MAX+1];
+    if (led.file_count) {
+        led_u8s_cpy_chars(fname, led.file_names[0]);
+        led.file_names++;
+        led.file_count--;
+    }
+    else if (led.stdin_ispipe && fgets(buf_fname, LED_FNAME_MAX, stdin))
+        led_u8s_cpy_chars(fname, buf_fname);
+    else
+        return false;
+    led_u8s_trim(fname);
+    return true;
+}
+
+void led_pool_print_out() {
+    pthread_mutex_lock(&led_pool.lock);
+    led_pool_task_t* ptask = &led_pool.tasks[led.worker.task];
+    ptask->name_out = strdup(led_u8s_str(&led.file_out.name));
+    pthread_mutex_unlock(&led_pool.lock);
+}
+
+static void led_pool_done() {
+    pthread_mutex_lock(&led_pool.lock);
+    led_pool.tasks[led.worker.task].done = true;
+    if (led.opt.jobs_unordered)
+        led_pool_print_task(&led_pool.tasks[led.worker.task]);
+    else
+        while (led_pool.print_pos < led_pool.task_count && led_pool.tasks[led_pool.print_pos].done)
+            led_pool_print_task(&led_pool.tasks[led_pool.print_pos++]);
+    pthread_mutex_unlock(&led_pool.lock);
+}
+
+static void* led_pool_worker(void* arg) {
+    led_ctx = (led_t*)arg;
+    led_debug("Worker %lu started", led.worker.id);
+    for (;;) {
+        pthread_mutex_lock(&led_pool.lock);
+        while (led_pool.todo_pos == led_pool.task_count && !led_pool.closed)
+            pthread_cond_wait(&led_pool.ready, &led_pool.lock);
+        if (led_pool.todo_pos == led_pool.task_count) {
+            pthread_mutex_unlock(&led_pool.lock);
+            break;
+        }
+        led.worker.task = led_pool.todo[led_pool.todo_pos++];
+        char* fname = led_pool.tasks[led.worker.task].name;
+        pthread_mutex_unlock(&led_pool.lock);
+
+        led.file_names = &fname;
+        led.file_count = 1;
+        while (led_file_next())
+            led_process_lines();
+        led_pool_done();
+    }
+    led_debug("Worker %lu stopped", led.worker.id);
+    led_free_runtime();
+    return NULL;
+}
+
+void led_pool_run() {
+    led_pool_start(led_pool_worker);
+
+    led_pool_task_t batch[LED_POOL_BATCH];
+    size_t count = 0;
+    led_u8s_decl(fname, LED_FNAME_MAX+1);
+    struct stat st;
+    while (led_pool_read_name(&fname)) {
+        if (led_u8s_isempty(&fname))
+            continue;
+        batch[count].name = strdup(led_u8s_str(&fname));
+        batch[count].name_out = NULL;
+        batch[count].size = stat(batch[count].name, &st) == 0 ? st.st_size : 0;
+        batch[count].done = false;
+        if (++count == LED_POOL_BATCH) {
+            led_pool_add(batch, count);
+            count = 0;
+        }
+    }
+    if (count)
+        led_pool_add(batch, count);
+
+    led_pool_stop();
+    led_debug("Worker pool files: %lu", led_pool.task_count);
+    free(led_pool.tasks);
+    free(led_pool.todo);
+}
+
+//-----------------------------------------------
+// LED worker pool: chunks of one stream
+//-----------------------------------------------
+
+static void* led_pool_chunk_worker(void* arg) {
+    led_ctx = (led_t*)arg;
+    led_debug("Chunk worker %lu started", led.worker.id);
+    for (;;) {
+        pthread_mutex_lock(&led_pool.lock);
+        while (led_pool.chunk_todo == led_pool.chunk_submit && !led_pool.closed)
+            pthread_cond_wait(&led_pool.ready, &led_pool.lock);
+        if (led_pool.chunk_todo == led_pool.chunk_submit) {
+            pthread_mutex_unlock(&led_pool.lock);
+            break;
+        }
+        led_pool_chunk_t* pchunk = &led_pool.chunks[led_pool.chunk_todo++ % led_pool.nchunk];
+        pthread_mutex_unlock(&led_pool.lock);
+
+        // the chunk owns its output buffer, the worker only borrows it
+        led.file_out.writer = pchunk->writer;
+        led_writer_open_mem(&led.file_out.writer);
+        led_reader_open_mem(&led.file_in.reader, pchunk->data, pchunk->len);
+        led.file_in.reader.valid = pchunk->len;
+        led.file_in.reader.ascii = pchunk->ascii;
+        led_file_sel_reset();
+        led_process_lines();
+        led_reader_close(&led.file_in.reader);
+
+        pthread_mutex_lock(&led_pool.lock);
+        pchunk->writer = led.file_out.writer;
+        // the file match is counted by the main context
+        pchunk->match_count = led.report.file_line_match_count;
+        led.report.file_line_match_count = 0;
+        pchunk->done = true;
+        pthread_cond_broadcast(&led_pool.done);
+        pthread_mutex_unlock(&led_pool.lock);
+    }
+    led_debug("Chunk worker %lu stopped", led.worker.id);
+    memset(&led.file_out.writer, 0, sizeof led.file_out.writer);
+    led.file_out.writer.fd = -1;
+    led_free_runtime();
+    return NULL;
+}
+
+static bool led_pool_chunk_fill(led_pool_chunk_t* pchunk) {
+    led_reader_t* preader = &led.file_in.reader;
+    // a fully loaded input stays in place, chunks are views on it
+    bool isview = preader->eof;
+    led_u8s_t line;
+    pchunk->len = 0;
+    pchunk->ascii = true;
+    while (pchunk->len < LED_POOL_CHUNK_SIZE && led_reader_line(preader, &line)) {
+        led.sel.total_count++;
+        // the chunk input is checked once by the main context
+        if (!led.opt.binary && !led_reader_check(preader, &line))
+            pchunk->ascii = false;
+        if (led.file_in.invalid)
+            break;
+        if (isview) {
+            if (pchunk->len == 0) pchunk->data = line.str;
+            pchunk->len = line.str + line.len - pchunk->data;
+            if (preader->pos > (size_t)(line.str + line.len - preader->data))
+                pchunk->len++;
+            continue;
+        }
+        if (pchunk->len + line.len + 1 > pchunk->buf_size) {
+            size_t buf_size = pchunk->buf_size ? pchunk->buf_size : LED_POOL_CHUNK_SIZE * 2;
+            while (buf_size < pchunk->len + line.len + 1) buf_size *= 2;
+            char* buf = realloc(pchunk->buf, buf_size);
+            led_assert(buf != NULL, LED_ERR_INTERNAL, "Chunk buffer allocation error (%lu)", buf_size);
+            pchunk->buf = buf;
+            pchunk->buf_size = buf_size;
+        }
+        memcpy(pchunk->buf + pchunk->len, line.str, line.len);
+        pchunk->len += line.len;
+        pchunk->buf[pchunk->len++] = '\n';
+        pchunk->data = pchunk->buf;
+    }
+    return pchunk->len > 0;
+}
+
+static void led_pool_chunk_write() {
+    led_pool_chunk_t* pchunk = &led_pool.chunks[led_pool.chunk_write % led_pool.nchunk];
+    pthread_mutex_lock(&led_pool.lock);
+    while (!pchunk->done)
+        pthread_cond_wait(&led_pool.done, &led_pool.lock);
+    pthread_mutex_unlock(&led_pool.lock);
+    led_writer_write(&led.file_out.writer, pchunk->writer.buf, pchunk->writer.len);
+    led.report.file_line_match_count += pchunk->match_count;
+    pchunk->done = false;
+    led_pool.chunk_write++;
+}
+
+void led_pool_run_chunks() {
+    led_pool_start(led_pool_chunk_worker);
+    // two chunks per worker keep the workers busy while the main thread reads and writes
+    led_pool.nchunk = led_pool.nworker * 2;
+    led_pool.chunks = calloc(led_pool.nchunk, sizeof *led_pool.chunks);
+    led_assert(led_pool.chunks != NULL, LED_ERR_INTERNAL, "Chunk ring allocation error (%lu)", led_pool.nchunk);
+
+    while (led_file_next()) {
+        for (;;) {
+            if (led_pool.chunk_submit - led_pool.chunk_write == led_pool.nchunk)
+                led_pool_chunk_write();
+            if (!led_pool_chunk_fill(&led_pool.chunks[led_pool.chunk_submit % led_pool.nchunk]))
+                break;
+            pthread_mutex_lock(&led_pool.lock);
+            led_pool.chunk_submit++;
+            pthread_cond_signal(&led_pool.ready);
+            pthread_mutex_unlock(&led_pool.lock);
+        }
+        // the file chunks are written before the next file is opened
+        while (led_pool.chunk_write < led_pool.chunk_submit)
+            led_pool_chunk_write();
+    }
+
+    led_pool_stop();
+    for (size_t i = 0; i < led_pool.nchunk; i++) {
+        free(led_pool.chunks[i].buf);
+        free(led_pool.chunks[i].writer.buf);
+    }
+    free(led_pool.chunks);
+}
@@ -19,12 +19,53 @@
 
 #include "led.h"
 
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LED_U8_SIMD
+#endif
+
+//-----------------------------------------------
+// LED arena functions
+//-----------------------------------------------
+
+void* led_arena_alloc(led_arena_t* parena, size_t size) {
+    // keep allocations aligned for any data type
+    size = (size + 15) & ~(size_t)15;
+    led_arena_chunk_t* pchunk = parena->chunk;
+    if (pchunk == NULL || pchunk->used + size > pchunk->size) {
+        size_t chunk_size = pchunk ? pchunk->size * 2 : LED_ARENA_CHUNK_MIN;
+        while (chunk_size < size) chunk_size *= 2;
+        pchunk = malloc(sizeof(led_arena_chunk_t) + chunk_size);
+        led_assert(pchunk != NULL, LED_ERR_INTERNAL, "Memory allocation error (%lu)", chunk_size);
+        pchunk->size = chunk_size;
+        pchunk->used = 0;
+        pchunk->next = parena->chunk;
+        parena->chunk = pchunk;
+        parena->total += chunk_size;
+    }
+    void* ptr = pchunk->data + pchunk->used;
+    pchunk->used += size;
+    return ptr;
+}
+
+void led_arena_free(led_arena_t* parena) {
+    while (parena->chunk != NULL) {
+        led_arena_chunk_t* pchunk = parena->chunk;
+        parena->chunk = pchunk->next;
+        free(pchunk);
+    }
+    parena->total = 0;
+}
+
 //-----------------------------------------------
 // LED str functions
 //-----------------------------------------------
 
 led_u8s_t* led_u8s_init(led_u8s_t* lstr, char* buf, size_t size) {
     lstr->str = buf;
+    lstr->pbuf = NULL;
     if (!lstr->str) {
         lstr->len = 0;
         lstr->size = 0;
@@ -36,14 +77,79 @@ led_u8s_t* led_u8s_init(led_u8s_t* lstr, char* buf, size_t size) {
     return lstr;
 }
 
-pcre2_code* LED_REGEX_ALL_LINE = NULL;
-pcre2_code* LED_REGEX_BLANK_LINE = NULL;
-pcre2_code* LED_REGEX_INTEGER = NULL;
-pcre2_code* LED_REGEX_REGISTER = NULL;
-pcre2_code* LED_REGEX_FUNC = NULL;
-pcre2_code* LED_REGEX_FUNC2 = NULL;
+led_u8s_t* led_u8s_init_pbuf(led_u8s_t* lstr, led_u8s_buf_t* pbuf) {
+    lstr->pbuf = pbuf;
+    if (pbuf->str == NULL) {
+        lstr->str = NULL;
+        lstr->len = lstr->size = 0;
+        led_u8s_grow(lstr, LED_LINE_INIT);
+    }
+    lstr->str = pbuf->str;
+    lstr->size = pbuf->size;
+    lstr->len = 0;
+    lstr->str[0] = '\0';
+    return lstr;
+}
+
+void led_u8s_grow(led_u8s_t* lstr, size_t size) {
+    led_u8s_buf_t* pbuf = lstr->pbuf;
+    led_arena_t* parena = pbuf->arena;
+    led_assert(parena->max == 0 || size <= parena->max + 1, LED_ERR_MAXLINE, "Line size exceeds the maximum of %lu bytes", parena->max);
+
+    // geometric growth, the previous buffer stays in the arena until the end of run
+    size_t buf_size = pbuf->size > LED_LINE_INIT ? pbuf->size : LED_LINE_INIT;
+    while (buf_size < size) buf_size *= 2;
+    if (parena->max > 0 && buf_size > parena->max + 1) buf_size = parena->max + 1;
+
+    char* str = led_arena_alloc(parena, buf_size);
+    if (lstr->str != NULL) {
+        memcpy(str, lstr->str, lstr->len);
+        str[lstr->len] = '\0';
+    }
+    pbuf->str = lstr->str = str;
+    pbuf->size = lstr->size = buf_size;
+}
+
+//-----------------------------------------------
+// LED regex registry
+//-----------------------------------------------
+
+// identical patterns are compiled once and shared by all the contexts
+static struct {
+    pthread_mutex_t lock;
+    led_regex_t** list;
+    size_t count;
+    size_t size;
+    pcre2_general_context* gctx;
+    pcre2_compile_context* cctx;
+} led_regex_registry = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+size_t led_regex_alloc_count = 0;
+
+led_regex_t* LED_REGEX_ALL_LINE = NULL;
+led_regex_t* LED_REGEX_BLANK_LINE = NULL;
+led_regex_t* LED_REGEX_INTEGER = NULL;
+led_regex_t* LED_REGEX_REGISTER = NULL;
+led_regex_t* LED_REGEX_FUNC = NULL;
+led_regex_t* LED_REGEX_FUNC2 = NULL;
+
+static void* led_regex_malloc(size_t size, void* data) {
+    (void)data;
+    __atomic_add_fetch(&led_regex_alloc_count, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void led_regex_mfree(void* ptr, void* data) {
+    (void)data;
+    free(ptr);
+}
 
 void led_regex_init() {
+    // all PCRE2 allocations are counted through the general context
+    if (led_regex_registry.gctx == NULL) {
+        led_regex_registry.gctx = pcre2_general_context_create(led_regex_malloc, led_regex_mfree, NULL);
+        led_regex_registry.cctx = pcre2_compile_context_create(led_regex_registry.gctx);
+    }
     if (LED_REGEX_ALL_LINE == NULL) LED_REGEX_ALL_LINE = led_regex_compile("^.*$");
     if (LED_REGEX_BLANK_LINE == NULL) LED_REGEX_BLANK_LINE = led_regex_compile("^[ \t]*$");
     if (LED_REGEX_INTEGER == NULL) LED_REGEX_INTEGER = led_regex_compile("^[0-9]+$");
@@ -53,44 +159,158 @@ void led_regex_init() {
 }
 
 void led_regex_free() {
-    if (LED_REGEX_ALL_LINE != NULL) { pcre2_code_free(LED_REGEX_ALL_LINE); LED_REGEX_ALL_LINE = NULL; }
-    if (LED_REGEX_BLANK_LINE != NULL) { pcre2_code_free(LED_REGEX_BLANK_LINE); LED_REGEX_BLANK_LINE = NULL; }
-    if (LED_REGEX_INTEGER != NULL) { pcre2_code_free(LED_REGEX_INTEGER); LED_REGEX_INTEGER = NULL; }
-    if (LED_REGEX_REGISTER != NULL) { pcre2_code_free(LED_REGEX_REGISTER); LED_REGEX_REGISTER = NULL; }
-    if (LED_REGEX_FUNC != NULL) { pcre2_code_free(LED_REGEX_FUNC); LED_REGEX_FUNC = NULL; }
-    if (LED_REGEX_FUNC2 != NULL) { pcre2_code_free(LED_REGEX_FUNC2); LED_REGEX_FUNC2 = NULL; }
+    for (size_t id = 0; id < led_regex_registry.count; id++) {
+        led_regex_t* regex = led_regex_registry.list[id];
+        if (regex != NULL) {
+            pcre2_code_free(regex->code);
+            free(regex->pattern);
+            free(regex);
+        }
+    }
+    free(led_regex_registry.list);
+    led_regex_registry.list = NULL;
+    led_regex_registry.count = 0;
+    led_regex_registry.size = 0;
+    LED_REGEX_ALL_LINE = NULL;
+    LED_REGEX_BLANK_LINE = NULL;
+    LED_REGEX_INTEGER = NULL;
+    LED_REGEX_REGISTER = NULL;
+    LED_REGEX_FUNC = NULL;
+    LED_REGEX_FUNC2 = NULL;
+    pcre2_compile_context_free(led_regex_registry.cctx);
+    pcre2_general_context_free(led_regex_registry.gctx);
+    led_regex_registry.cctx = NULL;
+    led_regex_registry.gctx = NULL;
 }
 
-pcre2_code* led_regex_compile(const char* pattern) {
+static bool led_regex_jit_isavailable() {
+    static int jit = -1;
+    if (jit < 0) {
+        uint32_t config = 0;
+        jit = pcre2_config(PCRE2_CONFIG_JIT, &config) >= 0 && config;
+    }
+    return jit;
+}
+
+led_regex_t* led_regex_compile(const char* pattern) {
     int pcre_err;
     PCRE2_SIZE pcre_erroff;
     PCRE2_UCHAR pcre_errbuf[256];
     led_assert(pattern != NULL, LED_ERR_ARG, "Missing regex");
-    pcre2_code* regex = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, PCRE2_UTF, &pcre_err, &pcre_erroff, NULL);
+
+    pthread_mutex_lock(&led_regex_registry.lock);
+    for (size_t id = 0; id < led_regex_registry.count; id++) {
+        led_regex_t* regex = led_regex_registry.list[id];
+        if (regex != NULL && strcmp(regex->pattern, pattern) == 0) {
+            regex->refs++;
+            pthread_mutex_unlock(&led_regex_registry.lock);
+            led_debug("Regex interned (%lu): %s", id, pattern);
+            return regex;
+        }
+    }
+    pthread_mutex_unlock(&led_regex_registry.lock);
+
+    pcre2_code* code = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED, PCRE2_UTF, &pcre_err, &pcre_erroff, led_regex_registry.cctx);
     pcre2_get_error_message(pcre_err, pcre_errbuf, sizeof(pcre_errbuf));
-    led_assert(regex != NULL, LED_ERR_PCRE, "Regex error \"%s\" offset %d: %s", pattern, pcre_erroff, pcre_errbuf);
+    led_assert(code != NULL, LED_ERR_PCRE, "Regex error \"%s\" offset %d: %s", pattern, pcre_erroff, pcre_errbuf);
+    // without JIT code the match runs on the interpreter
+    if (led_regex_jit_isavailable()) {
+        int rc = pcre2_jit_compile(code, PCRE2_JIT_COMPLETE);
+        if (rc < 0) led_debug("Regex JIT compile error (%d), interpreted: %s", rc, pattern);
+    }
+
+    led_regex_t* regex = malloc(sizeof *regex);
+    led_assert(regex != NULL, LED_ERR_INTERNAL, "Regex allocation error");
+    regex->pattern = strdup(pattern);
+    regex->code = code;
+    regex->refs = 1;
+
+    // ids are never reused, contexts index their match data with them
+    pthread_mutex_lock(&led_regex_registry.lock);
+    if (led_regex_registry.count == led_regex_registry.size) {
+        size_t size = led_regex_registry.size ? led_regex_registry.size * 2 : 32;
+        led_regex_t** list = realloc(led_regex_registry.list, size * sizeof *list);
+        if (list == NULL) pthread_mutex_unlock(&led_regex_registry.lock);
+        led_assert(list != NULL, LED_ERR_INTERNAL, "Regex registry allocation error");
+        led_regex_registry.list = list;
+        led_regex_registry.size = size;
+    }
+    regex->id = led_regex_registry.count++;
+    led_regex_registry.list[regex->id] = regex;
+    pthread_mutex_unlock(&led_regex_registry.lock);
+    led_debug("Regex compiled (%lu): %s", regex->id, pattern);
     return regex;
 }
 
-bool led_u8s_match(led_u8s_t* lstr, pcre2_code* regex) {
-    pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(regex, NULL);
-    int rc = pcre2_match(regex, (PCRE2_SPTR)lstr->str, lstr->len, 0, 0, match_data, NULL);
-    pcre2_match_data_free(match_data);
-    return rc > 0;
+void led_regex_release(led_regex_t* regex) {
+    pthread_mutex_lock(&led_regex_registry.lock);
+    if (--regex->refs == 0) {
+        led_regex_registry.list[regex->id] = NULL;
+        pcre2_code_free(regex->code);
+        free(regex->pattern);
+        free(regex);
+    }
+    pthread_mutex_unlock(&led_regex_registry.lock);
+}
+
+pcre2_match_data* led_regex_match_data(led_regex_t* regex) {
+    // each context owns one match data per regex, created on first use
+    if (regex->id >= led.regex.match_data_count) {
+        size_t count = led.regex.match_data_count ? led.regex.match_data_count : 16;
+        while (count <= regex->id) count *= 2;
+        pcre2_match_data** match_data = realloc(led.regex.match_data, count * sizeof *match_data);
+        led_assert(match_data != NULL, LED_ERR_INTERNAL, "Regex match data allocation error");
+        memset(match_data + led.regex.match_data_count, 0, (count - led.regex.match_data_count) * sizeof *match_data);
+        led.regex.match_data = match_data;
+        led.regex.match_data_count = count;
+    }
+    if (led.regex.match_data[regex->id] == NULL) {
+        led.regex.match_data[regex->id] = pcre2_match_data_create_from_pattern(regex->code, led_regex_registry.gctx);
+        led_assert(led.regex.match_data[regex->id] != NULL, LED_ERR_INTERNAL, "Regex match data allocation error");
+    }
+    return led.regex.match_data[regex->id];
+}
+
+pcre2_general_context* led_regex_gctx() {
+    return led_regex_registry.gctx;
+}
+
+int led_regex_match(led_regex_t* regex, const char* str, size_t len) {
+    pcre2_match_data* match_data = led_regex_match_data(regex);
+    uint32_t opts = led.opt.regex_nojit ? PCRE2_NO_JIT : 0;
+    int rc = pcre2_match(regex->code, (PCRE2_SPTR)str, len, 0, opts, match_data, led.regex.mctx);
+    if (rc == PCRE2_ERROR_JIT_STACKLIMIT) {
+        led_trace(LED_TRACE_REGEX, LED_TRACE_STEP, "Regex JIT stack limit reached, interpreted");
+        rc = pcre2_match(regex->code, (PCRE2_SPTR)str, len, 0, opts | PCRE2_NO_JIT, match_data, led.regex.mctx);
+    }
+    if (led.report.pstat != NULL) {
+        if (rc > 0) led.report.pstat->match_count++;
+        else led.report.pstat->nomatch_count++;
+    }
+    return rc;
+}
+
+bool led_u8s_match(led_u8s_t* lstr, led_regex_t* regex) {
+    return led_regex_match(regex, lstr->str, lstr->len) > 0;
+}
+
+bool led_u8s_match_pat(led_u8s_t* lstr, const char* pat) {
+    led_regex_t* regex = led_regex_compile(pat);
+    bool rc = led_u8s_match(lstr, regex);
+    led_regex_release(regex);
+    return rc;
 }
 
-bool led_u8s_match_offset(led_u8s_t* lstr, pcre2_code* regex, size_t* pzone_start, size_t* pzone_stop) {
-    pcre2_match_data* match_data = pcre2_match_data_create_from_pattern(regex, NULL);
-    int rc = pcre2_match(regex, (PCRE2_SPTR)lstr->str, lstr->len, 0, 0, match_data, NULL);
-    led_debug("match_offset %d ", rc);
+bool led_u8s_match_offset(led_u8s_t* lstr, led_regex_t* regex, size_t* pzone_start, size_t* pzone_stop) {
+    int rc = led_regex_match(regex, lstr->str, lstr->len);
+    led_trace(LED_TRACE_REGEX, LED_TRACE_STEP, "match_offset %d ", rc);
     if( rc > 0) {
-        PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
+        PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(led_regex_match_data(regex));
         int iv = (rc - 1) * 2;
         *pzone_start = ovector[iv];
         *pzone_stop = ovector[iv + 1];
-        led_debug("match_offset values %d (%c) - %d (%c)", *pzone_start, lstr->str[*pzone_start], *pzone_stop, lstr->str[*pzone_stop]);
+        led_trace(LED_TRACE_REGEX, LED_TRACE_DETAIL, "match_offset values %d (%c) - %d (%c)", *pzone_start, lstr->str[*pzone_start], *pzone_stop, lstr->str[*pzone_stop]);
     }
-    pcre2_match_data_free(match_data);
     return rc > 0;
 }
 
@@ -148,17 +368,6 @@ uint32_t led_u8c_decode(u8c_t c) {
   return c;
 }
 
-size_t led_u8c_from_str(char* str, u8c_t* u8chr) {
-    size_t l = led_u8c_size(str);
-    // led_debug("led_u8c_from_str - len=%lu", l);
-    u8c_t c = 0;
-    for (size_t i = 0; i < l && str[i]; i++)
-        c = (c << 8) | ((uint8_t*)str)[i];
-    // led_debug("led_u8c_from_str - c=%x", c);
-    *u8chr = c;
-    return l;
-}
-
 size_t led_u8c_from_rstr(char* str, size_t len, u8c_t* u8chr) {
     size_t u8chr_len = 0;
     u8c_t c = 0;
@@ -190,3 +399,922 @@ size_t led_u8c_to_str(char* str, u8c_t u8chr) {
     // led_debug("led_u8c_to_str - %x => %x %x %x %x", u8chr, (uint8_t)str[0], (uint8_t)str[1], (uint8_t)str[2], (uint8_t)str[3] );
     return l;
 }
+
+//-----------------------------------------------
+// LED utf8 buffer scans
+//-----------------------------------------------
+
+static size_t led_u8s_ascii_scalar(const char* str, size_t len) {
+    size_t i = 0;
+    for (uint64_t w; i + 8 <= len; i += 8) {
+        memcpy(&w, str + i, 8);
+        if (w & 0x8080808080808080) break;
+    }
+    while (i < len && (uint8_t)str[i] < 0x80) i++;
+    return i;
+}
+
+static size_t led_u8s_valid_scalar(const char* str, size_t len) {
+    const uint8_t* s = (const uint8_t*)str;
+    size_t i = 0;
+    while (i < len) {
+        i += led_u8s_ascii_scalar(str + i, len - i);
+        if (i == len) break;
+        uint8_t c = s[i];
+        size_t n;
+        uint32_t code, min;
+        if ((c & 0xE0) == 0xC0) { n = 2; code = c & 0x1F; min = 0x80; }
+        else if ((c & 0xF0) == 0xE0) { n = 3; code = c & 0x0F; min = 0x800; }
+        else if ((c & 0xF8) == 0xF0) { n = 4; code = c & 0x07; min = 0x10000; }
+        else return i;
+        if (i + n > len) return i;
+        for (size_t k = 1; k < n; k++) {
+            if ((s[i+k] & 0xC0) != 0x80) return i;
+            code = (code << 6) | (s[i+k] & 0x3F);
+        }
+        // overlong, surrogate and out of range codes are invalid
+        if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return i;
+        i += n;
+    }
+    return i;
+}
+
+#ifdef LED_U8_SIMD
+
+__attribute__((target("avx2")))
+static size_t led_u8s_ascii_avx2(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(str + i)), _mm256_loadu_si256((const __m256i*)(str + i + 32)));
+        if (_mm256_movemask_epi8(v)) break;
+    }
+    return i + led_u8s_ascii_scalar(str + i, len - i);
+}
+
+static size_t led_u8s_ascii_sse2(const char* str, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m128i v = _mm_or_si128(_mm_loadu_si128((const __m128i*)(str + i)), _mm_loadu_si128((const __m128i*)(str + i + 16)));
+        if (_mm_movemask_epi8(v)) break;
+    }
+    return i + led_u8s_ascii_scalar(str + i, len - i);
+}
+
+// Keiser & Lemire lookup validation: the error class of each byte is the AND of
+// three lookups (high nibble of the previous byte, low nibble of the previous byte,
+// high nibble of the byte), 3 and 4 bytes sequences are checked by the continuation
+// bytes expected from the bytes 2 and 3 positions before.
+#define LED_U8_TOO_SHORT 0x01
+#define LED_U8_TOO_LONG 0x02
+#define LED_U8_OVERLONG_3 0x04
+#define LED_U8_TOO_LARGE 0x08
+#define LED_U8_SURROGATE 0x10
+#define LED_U8_OVERLONG_2 0x20
+#define LED_U8_TOO_LARGE_1000 0x40
+#define LED_U8_OVERLONG_4 0x40
+#define LED_U8_TWO_CONTS 0x80
+#define LED_U8_CARRY (LED_U8_TOO_SHORT | LED_U8_TOO_LONG | LED_U8_TWO_CONTS)
+
+static const uint8_t led_u8_byte1_high[16] = {
+    LED_U8_TOO_LONG, LED_U8_TOO_LONG, LED_U8_TOO_LONG, LED_U8_TOO_LONG,
+    LED_U8_TOO_LONG, LED_U8_TOO_LONG, LED_U8_TOO_LONG, LED_U8_TOO_LONG,
+    LED_U8_TWO_CONTS, LED_U8_TWO_CONTS, LED_U8_TWO_CONTS, LED_U8_TWO_CONTS,
+    LED_U8_TOO_SHORT | LED_U8_OVERLONG_2,
+    LED_U8_TOO_SHORT,
+    LED_U8_TOO_SHORT | LED_U8_OVERLONG_3 | LED_U8_SURROGATE,
+    LED_U8_TOO_SHORT | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000 | LED_U8_OVERLONG_4,
+};
+
+static const uint8_t led_u8_byte1_low[16] = {
+    LED_U8_CARRY | LED_U8_OVERLONG_3 | LED_U8_OVERLONG_2 | LED_U8_OVERLONG_4,
+    LED_U8_CARRY | LED_U8_OVERLONG_2,
+    LED_U8_CARRY,
+    LED_U8_CARRY,
+    LED_U8_CARRY | LED_U8_TOO_LARGE,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000 | LED_U8_SURROGATE,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+    LED_U8_CARRY | LED_U8_TOO_LARGE | LED_U8_TOO_LARGE_1000,
+};
+
+static const uint8_t led_u8_byte2_high[16] = {
+    LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT,
+    LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT,
+    LED_U8_TOO_LONG | LED_U8_OVERLONG_2 | LED_U8_TWO_CONTS | LED_U8_OVERLONG_3 | LED_U8_TOO_LARGE_1000 | LED_U8_OVERLONG_4,
+    LED_U8_TOO_LONG | LED_U8_OVERLONG_2 | LED_U8_TWO_CONTS | LED_U8_OVERLONG_3 | LED_U8_TOO_LARGE,
+    LED_U8_TOO_LONG | LED_U8_OVERLONG_2 | LED_U8_TWO_CONTS | LED_U8_SURROGATE | LED_U8_TOO_LARGE,
+    LED_U8_TOO_LONG | LED_U8_OVERLONG_2 | LED_U8_TWO_CONTS | LED_U8_SURROGATE | LED_U8_TOO_LARGE,
+    LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT, LED_U8_TOO_SHORT,
+};
+
+__attribute__((target("ssse3")))
+static bool led_u8s_isvalid_ssse3(const char* str, size_t len) {
+    const __m128i t1h = _mm_loadu_si128((const __m128i*)led_u8_byte1_high);
+    const __m128i t1l = _mm_loadu_si128((const __m128i*)led_u8_byte1_low);
+    const __m128i t2h = _mm_loadu_si128((const __m128i*)led_u8_byte2_high);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    // the bytes expecting continuations after the block end
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1);
+    __m128i prev = _mm_setzero_si128();
+    __m128i err = _mm_setzero_si128();
+    __m128i incomplete = _mm_setzero_si128();
+    size_t i = 0;
+    while (i < len) {
+        __m128i in;
+        if (len - i >= 16) in = _mm_loadu_si128((const __m128i*)(str + i));
+        else {
+            // the last block is padded with zeros, a truncated sequence is then too short
+            char tail[16] = { 0 };
+            memcpy(tail, str + i, len - i);
+            in = _mm_loadu_si128((const __m128i*)tail);
+        }
+        i += 16;
+        if (_mm_movemask_epi8(in) == 0)
+            err = _mm_or_si128(err, incomplete);
+        else {
+            __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+            __m128i sc = _mm_and_si128(_mm_and_si128(
+                _mm_shuffle_epi8(t1h, _mm_and_si128(_mm_srli_epi16(prev1, 4), nib)),
+                _mm_shuffle_epi8(t1l, _mm_and_si128(prev1, nib))),
+                _mm_shuffle_epi8(t2h, _mm_and_si128(_mm_srli_epi16(in, 4), nib)));
+            __m128i prev2 = _mm_alignr_epi8(in, prev, 14);
+            __m128i prev3 = _mm_alignr_epi8(in, prev, 13);
+            __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80)), _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80)));
+            err = _mm_or_si128(err, _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(0x80)), sc));
+            incomplete = _mm_subs_epu8(in, max);
+        }
+        prev = in;
+    }
+    err = _mm_or_si128(err, incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) == 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static bool led_u8s_isvalid_avx2(const char* str, size_t len) {
+    const __m256i t1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)led_u8_byte1_high));
+    const __m256i t1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)led_u8_byte1_low));
+    const __m256i t2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)led_u8_byte2_high));
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i err = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i < len) {
+        __m256i in;
+        if (len - i >= 32) in = _mm256_loadu_si256((const __m256i*)(str + i));
+        else {
+            char tail[32] = { 0 };
+            memcpy(tail, str + i, len - i);
+            in = _mm256_loadu_si256((const __m256i*)tail);
+        }
+        i += 32;
+        if (_mm256_movemask_epi8(in) == 0)
+            err = _mm256_or_si256(err, incomplete);
+        else {
+            // the byte shifts cross the 128 bits lanes with the previous block high lane
+            __m256i cross = _mm256_permute2x128_si256(prev, in, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(in, cross, 15);
+            __m256i sc = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nib)),
+                _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nib))),
+                _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+            __m256i prev2 = _mm256_alignr_epi8(in, cross, 14);
+            __m256i prev3 = _mm256_alignr_epi8(in, cross, 13);
+            __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)), _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+            err = _mm256_or_si256(err, _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8(0x80)), sc));
+            incomplete = _mm256_subs_epu8(in, max);
+        }
+        prev = in;
+    }
+    err = _mm256_or_si256(err, incomplete);
+    return _mm256_testz_si256(err, err);
+}
+
+#endif
+
+size_t led_u8s_ascii_buf(const char* str, size_t len) {
+#ifdef LED_U8_SIMD
+    if (__builtin_cpu_supports("avx2")) return led_u8s_ascii_avx2(str, len);
+    return led_u8s_ascii_sse2(str, len);
+#else
+    return led_u8s_ascii_scalar(str, len);
+#endif
+}
+
+size_t led_u8s_valid_buf(const char* str, size_t len) {
+    // the vector check only tells if the buffer is valid, the scalar scan finds the position
+#ifdef LED_U8_SIMD
+    if (__builtin_cpu_supports("avx2")) {
+        if (led_u8s_isvalid_avx2(str, len)) return len;
+    }
+    else if (__builtin_cpu_supports("ssse3")) {
+        if (led_u8s_isvalid_ssse3(str, len)) return len;
+    }
+#endif
+    return led_u8s_valid_scalar(str, len);
+}
+
+//-----------------------------------------------
+// LED utf8 case conversion
+//-----------------------------------------------
+
+static const led_case_run_t* led_case_run_find(const led_case_run_t* runs, size_t count, uint32_t code) {
+    // branchless search of the last run starting before the code, the stride is 1 or 2
+    const led_case_run_t* run = runs;
+    for (size_t n = count; n > 1; n -= n / 2)
+        run = run[n / 2].first <= code ? run + n / 2 : run;
+    if (code < run->first || code > run->last || ((code - run->first) & (run->stride - 1))) return NULL;
+    return run;
+}
+
+static u8c_t led_u8c_case_map(const led_case_run_t* runs, size_t count, u8c_t c) {
+    uint32_t code = led_u8c_decode(c);
+    const led_case_run_t* run = led_case_run_find(runs, count, code);
+    return run != NULL ? led_u8c_encode(code + run->delta) : c;
+}
+
+u8c_t led_u8c_tolower_mb(u8c_t c) {
+    return led_u8c_case_map(led_case_lower, led_case_lower_count, c);
+}
+
+u8c_t led_u8c_toupper_mb(u8c_t c) {
+    return led_u8c_case_map(led_case_upper, led_case_upper_count, c);
+}
+
+bool led_u8c_isalnum_mb(u8c_t c) {
+    uint32_t code = led_u8c_decode(c);
+    const led_case_range_t* range = led_case_alnum;
+    for (size_t n = led_case_alnum_count; n > 1; n -= n / 2)
+        range = range[n / 2].first <= code ? range + n / 2 : range;
+    return code >= range->first && code <= range->last;
+}
+
+// convert the ASCII prefix of src into dst and return its length:
+// the letters of the range are flipped with the 0x20 case bit
+static size_t led_u8s_case_ascii_scalar(char* dst, const char* src, size_t len, bool upper) {
+    char first = upper ? 'a' : 'A';
+    size_t i = 0;
+    for (; i < len && (uint8_t)src[i] < 0x80; i++)
+        dst[i] = (uint8_t)(src[i] - first) < 26 ? src[i] ^ 0x20 : src[i];
+    return i;
+}
+
+#ifdef LED_U8_SIMD
+
+__attribute__((target("avx2")))
+static size_t led_u8s_case_ascii_avx2(char* dst, const char* src, size_t len, bool upper) {
+    const __m256i first = _mm256_set1_epi8((upper ? 'a' : 'A') - 1);
+    const __m256i last = _mm256_set1_epi8((upper ? 'z' : 'Z') + 1);
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(in)) break;
+        __m256i range = _mm256_and_si256(_mm256_cmpgt_epi8(in, first), _mm256_cmpgt_epi8(last, in));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(in, _mm256_and_si256(range, bit)));
+    }
+    return i + led_u8s_case_ascii_scalar(dst + i, src + i, len - i, upper);
+}
+
+static size_t led_u8s_case_ascii_sse2(char* dst, const char* src, size_t len, bool upper) {
+    const __m128i first = _mm_set1_epi8((upper ? 'a' : 'A') - 1);
+    const __m128i last = _mm_set1_epi8((upper ? 'z' : 'Z') + 1);
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(in)) break;
+        __m128i range = _mm_and_si128(_mm_cmpgt_epi8(in, first), _mm_cmpgt_epi8(last, in));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(in, _mm_and_si128(range, bit)));
+    }
+    return i + led_u8s_case_ascii_scalar(dst + i, src + i, len - i, upper);
+}
+
+#endif
+
+static size_t led_u8s_case_ascii(char* dst, const char* src, size_t len, bool upper) {
+#ifdef LED_U8_SIMD
+    // short runs between multibyte chars stay scalar
+    size_t n = led_u8s_case_ascii_scalar(dst, src, len < 16 ? len : 16, upper);
+    if (n < 16) return n;
+    if (__builtin_cpu_supports("avx2")) return n + led_u8s_case_ascii_avx2(dst + n, src + n, len - n, upper);
+    return n + led_u8s_case_ascii_sse2(dst + n, src + n, len - n, upper);
+#else
+    return led_u8s_case_ascii_scalar(dst, src, len, upper);
+#endif
+}
+
+led_u8s_t* led_u8s_app_case_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, bool upper) {
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    while (start < stop) {
+        size_t len = led_u8s_room(lstr, stop - start);
+        size_t n = led_u8s_case_ascii(lstr->str + lstr->len, lstr_src->str + start, len, upper);
+        lstr->len += n;
+        start += n;
+        // a multibyte char stops the ASCII run, a full buffer stops the conversion
+        if (n == len) break;
+        while (start < stop && (uint8_t)lstr_src->str[start] >= 0x80) {
+            u8c_t c = led_u8s_char_next(lstr_src, &start);
+            led_u8s_app_char(lstr, upper ? led_u8c_toupper_mb(c) : led_u8c_tolower_mb(c));
+        }
+    }
+    lstr->str[lstr->len] = '\0';
+    return lstr;
+}
+
+//-----------------------------------------------
+// LED utf8 ASCII map
+// A 128 entries table is looked up by 16 entries blocks (one shuffle each),
+// the block of each byte is selected by its high nibble.
+//-----------------------------------------------
+
+static size_t led_u8s_map_ascii_scalar(char* dst, const char* src, size_t len, const uint8_t* map) {
+    size_t i = 0;
+    for (; i < len && (uint8_t)src[i] < 0x80; i++)
+        dst[i] = map[(uint8_t)src[i]];
+    return i;
+}
+
+#ifdef LED_U8_SIMD
+
+__attribute__((target("avx2")))
+static size_t led_u8s_map_ascii_avx2(char* dst, const char* src, size_t len, const uint8_t* map, uint8_t blocks) {
+    __m256i table[8];
+    for (size_t b = 0; b < 8; b++)
+        table[b] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(map + b * 16)));
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(src + i));
+        if (_mm256_movemask_epi8(in)) break;
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(in, 4), nib);
+        __m256i out = in;
+        for (size_t b = 0; b < 8; b++) {
+            if (!(blocks & (1 << b))) continue;
+            __m256i isblock = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(b));
+            out = _mm256_blendv_epi8(out, _mm256_shuffle_epi8(table[b], in), isblock);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+    }
+    return i + led_u8s_map_ascii_scalar(dst + i, src + i, len - i, map);
+}
+
+__attribute__((target("ssse3")))
+static size_t led_u8s_map_ascii_ssse3(char* dst, const char* src, size_t len, const uint8_t* map, uint8_t blocks) {
+    __m128i table[8];
+    for (size_t b = 0; b < 8; b++)
+        table[b] = _mm_loadu_si128((const __m128i*)(map + b * 16));
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        if (_mm_movemask_epi8(in)) break;
+        __m128i high = _mm_and_si128(_mm_srli_epi16(in, 4), nib);
+        __m128i out = in;
+        for (size_t b = 0; b < 8; b++) {
+            if (!(blocks & (1 << b))) continue;
+            __m128i isblock = _mm_cmpeq_epi8(high, _mm_set1_epi8(b));
+            out = _mm_or_si128(_mm_andnot_si128(isblock, out), _mm_and_si128(isblock, _mm_shuffle_epi8(table[b], in)));
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+    return i + led_u8s_map_ascii_scalar(dst + i, src + i, len - i, map);
+}
+
+#endif
+
+size_t led_u8s_map_ascii(char* dst, const char* src, size_t len, const uint8_t* map, uint8_t blocks) {
+#ifdef LED_U8_SIMD
+    // short runs between multibyte chars stay scalar
+    if (len >= 32) {
+        if (__builtin_cpu_supports("avx2")) return led_u8s_map_ascii_avx2(dst, src, len, map, blocks);
+        if (__builtin_cpu_supports("ssse3")) return led_u8s_map_ascii_ssse3(dst, src, len, map, blocks);
+    }
+#else
+    (void)blocks;
+#endif
+    return led_u8s_map_ascii_scalar(dst, src, len, map);
+}
+
+//-----------------------------------------------
+// LED base64
+// Encoded by vector blocks of 24 input bytes (AVX2) or 12 (SSSE3): the bytes are spread
+// into 6 bits indexes by shuffle and multiplies, then shifted to the alphabet by a table
+// of offsets. Decoded by blocks of 32 or 16 chars checked with two nibble tables,
+// an invalid char (new line, padding, other) leaves the block to the scalar decoder.
+//-----------------------------------------------
+
+static const char led_b64_std[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char led_b64_url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// char values of both alphabets, 0xFF for the chars skipped
+static const uint8_t led_b64_value[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0x3E, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static size_t led_b64_encode_scalar(char* dst, const uint8_t* src, size_t len, const char* alphabet) {
+    size_t o = 0;
+    for (size_t i = 0; i + 3 <= len; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+        dst[o++] = alphabet[v >> 18];
+        dst[o++] = alphabet[(v >> 12) & 0x3F];
+        dst[o++] = alphabet[(v >> 6) & 0x3F];
+        dst[o++] = alphabet[v & 0x3F];
+    }
+    return o;
+}
+
+#ifdef LED_U8_SIMD
+
+__attribute__((target("avx2")))
+static size_t led_b64_encode_avx2(char* dst, const uint8_t* src, size_t len, const char* alphabet) {
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shift = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet[62] - 62, alphabet[63] - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet[62] - 62, alphabet[63] - 63, 'A', 0, 0);
+    size_t i = 0, o = 0;
+    // 24 bytes used of the 28 loaded
+    for (; i + 28 <= len; i += 24, o += 32) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(src + i))),
+            _mm_loadu_si128((const __m128i*)(src + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, spread);
+        __m256i idx = _mm256_or_si256(
+            _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040)),
+            _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010)));
+        // shift table index: 13 for 0-25, 0 for 26-51, 1-12 for 52-63
+        __m256i range = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx), _mm256_set1_epi8(13)));
+        __m256i out = _mm256_add_epi8(idx, _mm256_shuffle_epi8(shift, range));
+        _mm256_storeu_si256((__m256i*)(dst + o), out);
+    }
+    return o + led_b64_encode_scalar(dst + o, src + i, len - i, alphabet);
+}
+
+__attribute__((target("ssse3")))
+static size_t led_b64_encode_ssse3(char* dst, const uint8_t* src, size_t len, const char* alphabet) {
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m128i shift = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, alphabet[62] - 62, alphabet[63] - 63, 'A', 0, 0);
+    size_t i = 0, o = 0;
+    // 12 bytes used of the 16 loaded
+    for (; i + 16 <= len; i += 12, o += 16) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i)), spread);
+        __m128i idx = _mm_or_si128(
+            _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040)),
+            _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010)));
+        __m128i range = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+        range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+        __m128i out = _mm_add_epi8(idx, _mm_shuffle_epi8(shift, range));
+        _mm_storeu_si128((__m128i*)(dst + o), out);
+    }
+    return o + led_b64_encode_scalar(dst + o, src + i, len - i, alphabet);
+}
+
+// blocks of 32 valid chars decoded into 24 bytes, 32 bytes are stored: room is checked on 32
+__attribute__((target("avx2")))
+static size_t led_b64_decode_avx2(char* dst, size_t* pout, const char* src, size_t len, size_t room) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    size_t i = 0, o = *pout;
+    for (; i + 32 <= len && o + 32 <= room; i += 32, o += 24) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(src + i));
+        // URL-safe chars to the standard ones
+        in = _mm256_blendv_epi8(in, _mm256_set1_epi8('+'), _mm256_cmpeq_epi8(in, _mm256_set1_epi8('-')));
+        in = _mm256_blendv_epi8(in, _mm256_set1_epi8('/'), _mm256_cmpeq_epi8(in, _mm256_set1_epi8('_')));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi32(in, 4), nib);
+        __m256i lo = _mm256_and_si256(in, nib);
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi))) break;
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, _mm256_set1_epi8('/')), hi));
+        __m256i val = _mm256_add_epi8(in, roll);
+        // 4 x 6 bits to 3 bytes, then the 12 bytes of each lane together
+        val = _mm256_maddubs_epi16(val, _mm256_set1_epi32(0x01400140));
+        val = _mm256_madd_epi16(val, _mm256_set1_epi32(0x00011000));
+        val = _mm256_shuffle_epi8(val, pack);
+        val = _mm256_permutevar8x32_epi32(val, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm256_storeu_si256((__m256i*)(dst + o), val);
+    }
+    *pout = o;
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static size_t led_b64_decode_ssse3(char* dst, size_t* pout, const char* src, size_t len, size_t room) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    size_t i = 0, o = *pout;
+    for (; i + 16 <= len && o + 16 <= room; i += 16, o += 12) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i url = _mm_cmpeq_epi8(in, _mm_set1_epi8('-'));
+        in = _mm_or_si128(_mm_andnot_si128(url, in), _mm_and_si128(url, _mm_set1_epi8('+')));
+        url = _mm_cmpeq_epi8(in, _mm_set1_epi8('_'));
+        in = _mm_or_si128(_mm_andnot_si128(url, in), _mm_and_si128(url, _mm_set1_epi8('/')));
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), nib);
+        __m128i lo = _mm_and_si128(in, nib);
+        __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF) break;
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hi));
+        __m128i val = _mm_add_epi8(in, roll);
+        val = _mm_maddubs_epi16(val, _mm_set1_epi32(0x01400140));
+        val = _mm_madd_epi16(val, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*)(dst + o), _mm_shuffle_epi8(val, pack));
+    }
+    *pout = o;
+    return i;
+}
+
+#endif
+
+static size_t led_b64_encode(char* dst, const uint8_t* src, size_t len, const char* alphabet) {
+#ifdef LED_U8_SIMD
+    if (__builtin_cpu_supports("avx2")) return led_b64_encode_avx2(dst, src, len, alphabet);
+    if (__builtin_cpu_supports("ssse3")) return led_b64_encode_ssse3(dst, src, len, alphabet);
+#endif
+    return led_b64_encode_scalar(dst, src, len, alphabet);
+}
+
+static size_t led_b64_decode_blocks(char* dst, size_t* pout, const char* src, size_t len, size_t room) {
+#ifdef LED_U8_SIMD
+    if (__builtin_cpu_supports("avx2")) return led_b64_decode_avx2(dst, pout, src, len, room);
+    if (__builtin_cpu_supports("ssse3")) return led_b64_decode_ssse3(dst, pout, src, len, room);
+#else
+    (void)dst; (void)pout; (void)src; (void)len; (void)room;
+#endif
+    return 0;
+}
+
+led_u8s_t* led_u8s_app_b64_encode_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, uint32_t flags) {
+    const char* alphabet = flags & LED_B64_URL ? led_b64_url : led_b64_std;
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    while (start < stop) {
+        // whole groups of 3 bytes in the room left, the last group may be partial
+        size_t len = led_u8s_room(lstr, (stop - start + 2) / 3 * 4) / 4 * 3;
+        if (len == 0) break;
+        if (len > stop - start) len = stop - start;
+        const uint8_t* src = (const uint8_t*)lstr_src->str + start;
+        char* dst = lstr->str + lstr->len;
+        size_t full = len / 3 * 3;
+        size_t o = led_b64_encode(dst, src, full, alphabet);
+        if (full < len) {
+            uint32_t v = (uint32_t)src[full] << 16 | (full + 1 < len ? (uint32_t)src[full + 1] << 8 : 0);
+            dst[o++] = alphabet[v >> 18];
+            dst[o++] = alphabet[(v >> 12) & 0x3F];
+            if (full + 1 < len) dst[o++] = alphabet[(v >> 6) & 0x3F];
+            else if (!(flags & LED_B64_NOPAD)) dst[o++] = '=';
+            if (!(flags & LED_B64_NOPAD)) dst[o++] = '=';
+        }
+        lstr->len += o;
+        start += len;
+    }
+    lstr->str[lstr->len] = '\0';
+    return lstr;
+}
+
+led_u8s_t* led_u8s_app_b64_decode_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop) {
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    uint32_t quad = 0;
+    size_t count = 0;
+    while (start < stop) {
+        // the vector stores overflow the decoded bytes by 8 at most
+        size_t room = led_u8s_room(lstr, (stop - start) / 4 * 3 + 8);
+        if (room < 3) break;
+        char* dst = lstr->str + lstr->len;
+        size_t o = 0;
+        // vector blocks from a group boundary, the scalar decoder skips the invalid chars
+        // and completes a group before the vector blocks are tried again
+        if (count == 0) start += led_b64_decode_blocks(dst, &o, lstr_src->str + start, stop - start, room);
+        while (start < stop && o + 3 <= room) {
+            uint8_t v = led_b64_value[(uint8_t)lstr_src->str[start++]];
+            if (v == 0xFF) continue;
+            quad = quad << 6 | v;
+            if (++count == 4) {
+                dst[o++] = quad >> 16;
+                dst[o++] = quad >> 8;
+                dst[o++] = quad;
+                quad = count = 0;
+                break;
+            }
+        }
+        lstr->len += o;
+    }
+    // partial last group (missing padding)
+    if (count >= 2 && led_u8s_room(lstr, count - 1) == count - 1) {
+        quad <<= 6 * (4 - count);
+        lstr->str[lstr->len++] = quad >> 16;
+        if (count == 3) lstr->str[lstr->len++] = quad >> 8;
+    }
+    lstr->str[lstr->len] = '\0';
+    return lstr;
+}
+
+//-----------------------------------------------
+// LED char sets
+//-----------------------------------------------
+
+static int led_charset_cmp(const void* a, const void* b) {
+    u8c_t ca = *(const u8c_t*)a;
+    u8c_t cb = *(const u8c_t*)b;
+    return ca < cb ? -1 : ca > cb;
+}
+
+void led_charset_init(led_charset_t* pset, led_u8s_t* lchars) {
+    memset(pset, 0, sizeof *pset);
+    size_t count = 0;
+    for (size_t i = 0; i < led_u8s_len(lchars); count++)
+        led_u8s_char_next(lchars, &i);
+    pset->mb = malloc((count + 1) * sizeof *pset->mb);
+    led_assert(pset->mb != NULL, LED_ERR_INTERNAL, "Char set allocation error");
+    for (size_t i = 0; i < led_u8s_len(lchars); ) {
+        u8c_t c = led_u8s_char_next(lchars, &i);
+        if (c < 0x100) {
+            pset->byte[c >> 3] |= 1 << (c & 7);
+            if (c < 0x80) pset->nibble_low[c & 0x0F] |= 1 << (c >> 4);
+        }
+        else
+            pset->mb[pset->mb_count++] = c;
+    }
+    qsort(pset->mb, pset->mb_count, sizeof *pset->mb, &led_charset_cmp);
+}
+
+void led_charset_free(led_charset_t* pset) {
+    free(pset->mb);
+    pset->mb = NULL;
+    pset->mb_count = 0;
+}
+
+bool led_charset_has_mb(const led_charset_t* pset, u8c_t c) {
+    return bsearch(&c, pset->mb, pset->mb_count, sizeof c, &led_charset_cmp) != NULL;
+}
+
+// the candidate bytes: the ASCII chars given by the nibble tables (exact) and,
+// when high is set, all the non ASCII bytes
+
+#ifdef LED_U8_SIMD
+
+__attribute__((target("avx2")))
+static size_t led_u8s_nibble_scan_avx2(const uint8_t* nibble_low, bool high, const char* str, size_t len) {
+    const __m256i lut_low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)nibble_low));
+    const __m256i lut_high = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i nib = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i*)(str + i));
+        __m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(lut_low, _mm256_and_si256(in, nib)),
+            _mm256_shuffle_epi8(lut_high, _mm256_and_si256(_mm256_srli_epi16(in, 4), nib)));
+        uint32_t mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256()));
+        if (high) mask |= _mm256_movemask_epi8(in);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static size_t led_u8s_nibble_scan_ssse3(const uint8_t* nibble_low, bool high, const char* str, size_t len) {
+    const __m128i lut_low = _mm_loadu_si128((const __m128i*)nibble_low);
+    const __m128i lut_high = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nib = _mm_set1_epi8(0x0F);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*)(str + i));
+        __m128i bits = _mm_and_si128(_mm_shuffle_epi8(lut_low, _mm_and_si128(in, nib)),
+            _mm_shuffle_epi8(lut_high, _mm_and_si128(_mm_srli_epi16(in, 4), nib)));
+        uint32_t mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128())) & 0xFFFF;
+        if (high) mask |= _mm_movemask_epi8(in);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i;
+}
+
+#endif
+
+// position of the first candidate byte, or the position where the blocks stopped
+static size_t led_u8s_nibble_scan(const uint8_t* nibble_low, bool high, const char* str, size_t len) {
+#ifdef LED_U8_SIMD
+    if (len >= 32) {
+        if (__builtin_cpu_supports("avx2")) return led_u8s_nibble_scan_avx2(nibble_low, high, str, len);
+        if (__builtin_cpu_supports("ssse3")) return led_u8s_nibble_scan_ssse3(nibble_low, high, str, len);
+    }
+#else
+    (void)nibble_low;
+    (void)high;
+    (void)str;
+    (void)len;
+#endif
+    return 0;
+}
+
+size_t led_charset_find(const led_charset_t* pset, led_u8s_t* lstr, size_t start, size_t stop) {
+    if (stop > lstr->len) stop = lstr->len;
+    while (start < stop) {
+        // the multibyte chars of the set are candidates by all their non ASCII bytes
+        size_t i = start + led_u8s_nibble_scan(pset->nibble_low, pset->mb_count > 0, lstr->str + start, stop - start);
+        if (i >= stop) break;
+        // the candidate (or the tail after the blocks) is checked by char, from the char start
+        while (i > start && led_u8c_iscont(lstr->str[i])) i--;
+        start = i;
+        if (led_charset_has(pset, led_u8s_char_next(lstr, &i))) return start;
+        start = i;
+    }
+    return stop;
+}
+
+//-----------------------------------------------
+// LED escape schemes
+//-----------------------------------------------
+
+static const char led_esc_hex[] = "0123456789ABCDEF";
+
+void led_esc_init(led_esc_t* pesc) {
+    memset(pesc->nibble_low, 0, sizeof pesc->nibble_low);
+    pesc->high = false;
+    for (size_t c = 0; c < 256; c++) {
+        if (pesc->byte[c] == LED_ESC_NONE) continue;
+        if (c < 0x80) pesc->nibble_low[c & 0x0F] |= 1 << (c >> 4);
+        else pesc->high = true;
+    }
+    // the vector scan flags all the non ASCII bytes or none of them
+    for (size_t c = 0x80; c < 256; c++)
+        led_assert(pesc->high == (pesc->byte[c] != LED_ESC_NONE), LED_ERR_INTERNAL, "Escape scheme with partial non ASCII bytes");
+}
+
+led_u8s_t* led_u8s_app_esc_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, const led_esc_t* pesc) {
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    const char* src = lstr_src->str;
+    while (start < stop) {
+        // run copied as is: exact by vector blocks, then the tail by bytes
+        size_t i = start + led_u8s_nibble_scan(pesc->nibble_low, pesc->high, src + start, stop - start);
+        while (i < stop && pesc->byte[(uint8_t)src[i]] == LED_ESC_NONE) i++;
+        led_u8s_app_buf(lstr, src + start, i - start);
+        if (i == stop) break;
+
+        uint8_t c = src[i];
+        uint8_t esc = pesc->byte[c];
+        char buf[6];
+        size_t len = 0;
+        if (esc == LED_ESC_PCT) {
+            buf[len++] = '%';
+            buf[len++] = led_esc_hex[c >> 4];
+            buf[len++] = led_esc_hex[c & 0x0F];
+        }
+        else if (esc == LED_ESC_U4) {
+            memcpy(buf, "\\u00", 4);
+            len = 4;
+            buf[len++] = led_esc_hex[c >> 4];
+            buf[len++] = led_esc_hex[c & 0x0F];
+        }
+        else if (esc == LED_ESC_OCT) {
+            buf[len++] = '\\';
+            buf[len++] = '0' + (c >> 6);
+            buf[len++] = '0' + ((c >> 3) & 7);
+            buf[len++] = '0' + (c & 7);
+        }
+        else {
+            buf[len++] = '\\';
+            buf[len++] = esc == LED_ESC_BSL ? (char)c : (char)esc;
+        }
+        led_u8s_app_buf(lstr, buf, len);
+        start = i + 1;
+    }
+    lstr->str[lstr->len] = '\0';
+    return lstr;
+}
+
+static int led_esc_hexval(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// value of n hex digits at str (-1 if one is not)
+static long led_esc_hexnum(const char* str, size_t n) {
+    long v = 0;
+    for (size_t i = 0; i < n; i++) {
+        int h = led_esc_hexval(str[i]);
+        if (h < 0) return -1;
+        v = v << 4 | h;
+    }
+    return v;
+}
+
+// decode the escape sequence at str (after the escape char) and return its length,
+// 0 when the sequence is not valid for the scheme and is copied as is
+static size_t led_esc_decode(led_u8s_t* lstr, const char* str, size_t len, led_unesc_t scheme) {
+    char c = str[0];
+    if (scheme == LED_UNESC_URL) {
+        long v = len >= 2 ? led_esc_hexnum(str, 2) : -1;
+        if (v < 0) return 0;
+        char b = v;
+        led_u8s_app_buf(lstr, &b, 1);
+        return 2;
+    }
+    if (scheme == LED_UNESC_SHELL) {
+        led_u8s_app_buf(lstr, str, 1);
+        return 1;
+    }
+    static const char CTRL_C[] = "a\ab\bf\fn\nr\rt\tv\v\\\\''\"\"??";
+    static const char CTRL_JSON[] = "b\bf\fn\nr\rt\t\\\\\"\"//";
+    const char* ctrl = scheme == LED_UNESC_C ? CTRL_C : CTRL_JSON;
+    for (size_t i = 0; ctrl[i]; i += 2) {
+        if (ctrl[i] == c) {
+            led_u8s_app_buf(lstr, ctrl + i + 1, 1);
+            return 1;
+        }
+    }
+    if (scheme == LED_UNESC_C) {
+        // up to 3 octal digits or 2 hex digits
+        size_t n = 0;
+        unsigned v = 0;
+        if (c >= '0' && c <= '7') {
+            for (; n < 3 && n < len && str[n] >= '0' && str[n] <= '7'; n++)
+                v = v << 3 | (str[n] - '0');
+        }
+        else if (c == 'x') {
+            for (n = 1; n < 3 && n < len && led_esc_hexval(str[n]) >= 0; n++)
+                v = v << 4 | led_esc_hexval(str[n]);
+            if (n == 1) return 0;
+        }
+        else return 0;
+        char b = v;
+        led_u8s_app_buf(lstr, &b, 1);
+        return n;
+    }
+    // JSON \uXXXX, with a surrogate pair for the chars out of the BMP
+    long code = c == 'u' && len >= 5 ? led_esc_hexnum(str + 1, 4) : -1;
+    if (code < 0) return 0;
+    size_t n = 5;
+    if (code >= 0xD800 && code <= 0xDBFF && len >= 11 && str[5] == '\\' && str[6] == 'u') {
+        long low = led_esc_hexnum(str + 7, 4);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            n = 11;
+        }
+    }
+    // a lone surrogate is replaced
+    if (code >= 0xD800 && code <= 0xDFFF) code = 0xFFFD;
+    led_u8s_app_char(lstr, led_u8c_encode(code));
+    return n;
+}
+
+led_u8s_t* led_u8s_app_unesc_zn(led_u8s_t* lstr, led_u8s_t* lstr_src, size_t start, size_t stop, led_unesc_t scheme) {
+    if (stop > lstr_src->len) stop = lstr_src->len;
+    const char* src = lstr_src->str;
+    const char escchar = scheme == LED_UNESC_URL ? '%' : '\\';
+    while (start < stop) {
+        // run copied as is up to the next escape char
+        const char* pesc = memchr(src + start, escchar, stop - start);
+        size_t i = pesc != NULL ? (size_t)(pesc - src) : stop;
+        led_u8s_app_buf(lstr, src + start, i - start);
+        if (i == stop) break;
+        // a sequence not decoded keeps its escape char
+        size_t n = i + 1 < stop ? led_esc_decode(lstr, src + i + 1, stop - i - 1, scheme) : 0;
+        if (n == 0) led_u8s_app_buf(lstr, src + i, 1);
+        start = i + 1 + n;
+    }
+    lstr->str[lstr->len] = '\0';
+    return lstr;
+}
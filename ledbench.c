@@ -0,0 +1,243 @@
+/***************************************************************************
+ Copyright (C) 2024 - Olivier ROUITS <olivier.rouits@free.fr>
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301
+ USA
+ ***************************************************************************/
+
+
+#include "led.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define LED_BENCH_UNIT "cycles"
+#else
+#include <time.h>
+#define LED_BENCH_UNIT "ns"
+#endif
+
+//-----------------------------------------------
+// LEDBENCH micro benchmarks of the UTF-8 string primitives
+// usage: ledbench [input size] [repeat count]
+//-----------------------------------------------
+
+#define LED_BENCH_SIZE 0x40000
+#define LED_BENCH_REPEAT 50
+#define LED_BENCH_WARMUP 5
+
+typedef struct {
+    const char* name;
+    led_u8s_t lstr;
+    u8c_t* chars;
+    size_t char_count;
+    led_u8s_t out;
+} led_bench_input_t;
+
+typedef uint64_t (*led_bench_fn_t)(led_bench_input_t* pin);
+
+volatile uint64_t led_bench_sink;
+
+static inline uint64_t led_bench_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+uint32_t led_bench_seed = 12345;
+
+uint32_t led_bench_rand(uint32_t n) {
+    led_bench_seed = (uint32_t)(((uint64_t)led_bench_seed * 16807) % 2147483647);
+    return led_bench_seed % n;
+}
+
+// code point generators for each input kind
+
+uint32_t led_bench_code_ascii() {
+    return led_bench_rand(8) ? 'a' + led_bench_rand(26) : ' ';
+}
+
+uint32_t led_bench_code_mixed() {
+    uint32_t r = led_bench_rand(100);
+    if (r < 70) return led_bench_code_ascii();
+    if (r < 90) return 0xC0 + led_bench_rand(0x140);
+    if (r < 97) return 0x4E00 + led_bench_rand(0x1000);
+    return 0x1F600 + led_bench_rand(0x50);
+}
+
+uint32_t led_bench_code_4b() {
+    return 0x1F300 + led_bench_rand(0x300);
+}
+
+void led_bench_input_init(led_bench_input_t* pin, const char* name, uint32_t (*code)(), size_t size) {
+    pin->name = name;
+    led_u8s_init(&pin->lstr, malloc(size + 1), size + 1);
+    pin->chars = malloc(size * sizeof(u8c_t));
+    led_u8s_init(&pin->out, malloc(size + 1), size + 1);
+    pin->char_count = 0;
+    for (;;) {
+        u8c_t c = led_u8c_encode(code());
+        char buf[4];
+        if (led_u8s_len(&pin->lstr) + led_u8c_to_str(buf, c) >= size) break;
+        led_u8s_app_char(&pin->lstr, c);
+        pin->chars[pin->char_count++] = c;
+    }
+}
+
+void led_bench_input_free(led_bench_input_t* pin) {
+    free(pin->lstr.str);
+    free(pin->chars);
+    free(pin->out.str);
+}
+
+//-----------------------------------------------
+// LEDBENCH primitives
+//-----------------------------------------------
+
+uint64_t led_bench_char_next(led_bench_input_t* pin) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (i < led_u8s_len(&pin->lstr))
+        sum += led_u8s_char_next(&pin->lstr, &i);
+    return sum;
+}
+
+uint64_t led_bench_u8c_from_str(led_bench_input_t* pin) {
+    uint64_t sum = 0;
+    char* str = led_u8s_str(&pin->lstr);
+    char* end = str + led_u8s_len(&pin->lstr);
+    u8c_t c;
+    while (str < end) {
+        str += led_u8c_from_str(str, &c);
+        sum += c;
+    }
+    return sum;
+}
+
+uint64_t led_bench_app_char(led_bench_input_t* pin) {
+    led_u8s_empty(&pin->out);
+    for (size_t i = 0; i < pin->char_count; i++)
+        led_u8s_app_char(&pin->out, pin->chars[i]);
+    return led_u8s_len(&pin->out);
+}
+
+uint64_t led_bench_find_char_zn(led_bench_input_t* pin) {
+    // the searched char is never found: the whole input is scanned
+    return led_u8s_find_char_zn(&pin->lstr, '\n', 0, led_u8s_len(&pin->lstr));
+}
+
+uint64_t led_bench_ischar(led_bench_input_t* pin) {
+    // separator lookup of each input char, as done by the split and field functions
+    led_u8s_decl_str(seps, ",;| \t");
+    uint64_t count = 0;
+    for (size_t i = 0; i < pin->char_count; i++)
+        count += led_u8s_ischar(&seps, pin->chars[i]);
+    return count;
+}
+
+uint64_t led_bench_ascii_buf(led_bench_input_t* pin) {
+    return led_u8s_ascii_buf(led_u8s_str(&pin->lstr), led_u8s_len(&pin->lstr));
+}
+
+uint64_t led_bench_valid_buf(led_bench_input_t* pin) {
+    return led_u8s_valid_buf(led_u8s_str(&pin->lstr), led_u8s_len(&pin->lstr));
+}
+
+uint64_t led_bench_app_case_zn(led_bench_input_t* pin) {
+    led_u8s_empty(&pin->out);
+    led_u8s_app_case_zn(&pin->out, &pin->lstr, 0, led_u8s_len(&pin->lstr), true);
+    return led_u8s_len(&pin->out);
+}
+
+uint64_t led_bench_app_b64_encode_zn(led_bench_input_t* pin) {
+    led_u8s_empty(&pin->out);
+    // the first 3/4 of the input fill the output buffer
+    led_u8s_app_b64_encode_zn(&pin->out, &pin->lstr, 0, led_u8s_len(&pin->lstr) / 4 * 3, 0);
+    return led_u8s_len(&pin->out);
+}
+
+uint64_t led_bench_hash_xxh3(led_bench_input_t* pin) {
+    uint8_t digest[LED_HASH_SIZE_MAX];
+    led_hash_digest(LED_HASH_XXH3, led_u8s_str(&pin->lstr), led_u8s_len(&pin->lstr), digest);
+    return digest[0];
+}
+
+uint64_t led_bench_hash_sha256(led_bench_input_t* pin) {
+    uint8_t digest[LED_HASH_SIZE_MAX];
+    led_hash_digest(LED_HASH_SHA256, led_u8s_str(&pin->lstr), led_u8s_len(&pin->lstr), digest);
+    return digest[0];
+}
+
+//-----------------------------------------------
+// LEDBENCH runner
+//-----------------------------------------------
+
+void led_bench_run(const char* name, led_bench_fn_t fn, led_bench_input_t* pin, size_t repeat) {
+    uint64_t best = UINT64_MAX;
+    for (size_t i = 0; i < LED_BENCH_WARMUP; i++)
+        led_bench_sink += fn(pin);
+    for (size_t i = 0; i < repeat; i++) {
+        uint64_t t = led_bench_clock();
+        led_bench_sink += fn(pin);
+        t = led_bench_clock() - t;
+        if (t < best) best = t;
+    }
+    size_t len = led_u8s_len(&pin->lstr);
+    printf("%-20s %-6s %10lu %10lu %12lu %10.3f %10.3f\n", name, pin->name, len, pin->char_count, best,
+        (double)best / len, (double)best / pin->char_count);
+}
+
+#define bench(NAME, PIN, REPEAT) led_bench_run(#NAME, led_bench_##NAME, PIN, REPEAT)
+
+//-----------------------------------------------
+// LEDBENCH main
+//-----------------------------------------------
+
+int main(int argc, char* argv[]) {
+    size_t size = argc > 1 ? strtoul(argv[1], NULL, 0) : LED_BENCH_SIZE;
+    size_t repeat = argc > 2 ? strtoul(argv[2], NULL, 0) : LED_BENCH_REPEAT;
+    led_assert(size >= 16 && repeat > 0, LED_ERR_ARG, "Invalid bench size or repeat count");
+
+    led_bench_input_t inputs[3];
+    led_bench_input_init(&inputs[0], "ascii", led_bench_code_ascii, size);
+    led_bench_input_init(&inputs[1], "mixed", led_bench_code_mixed, size);
+    led_bench_input_init(&inputs[2], "4b", led_bench_code_4b, size);
+
+    printf("%-20s %-6s %10s %10s %12s %10s %10s\n", "BENCH", "INPUT", "BYTES", "CHARS",
+        LED_BENCH_UNIT, LED_BENCH_UNIT "/B", LED_BENCH_UNIT "/C");
+    for (size_t i = 0; i < 3; i++) {
+        bench(char_next, &inputs[i], repeat);
+        bench(u8c_from_str, &inputs[i], repeat);
+        bench(app_char, &inputs[i], repeat);
+        bench(find_char_zn, &inputs[i], repeat);
+        bench(ischar, &inputs[i], repeat);
+        bench(ascii_buf, &inputs[i], repeat);
+        bench(valid_buf, &inputs[i], repeat);
+        bench(app_case_zn, &inputs[i], repeat);
+        bench(app_b64_encode_zn, &inputs[i], repeat);
+        bench(hash_xxh3, &inputs[i], repeat);
+        bench(hash_sha256, &inputs[i], repeat);
+    }
+
+    for (size_t i = 0; i < 3; i++)
+        led_bench_input_free(&inputs[i]);
+    return 0;
+}
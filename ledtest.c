@@ -62,6 +62,282 @@ void led_test_cut_next() {
     led_assert(led_u8s_equal_str(&test, "charà/charÂ"), LED_ERR_INTERNAL, "led_test_cut_next");
     led_assert(led_u8s_equal_str(&tok, "chara"), LED_ERR_INTERNAL, "led_test_cut_next");
 }
+void led_test_lib_run() {
+    led_t* pctx;
+    const char* out;
+    size_t out_len;
+    const char* args[] = { "s/a/b/g" };
+    led_assert(led_lib_compile(&pctx, 1, args) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_lib_run");
+    for (int i = 0; i < 2; i++) {
+        led_assert(led_lib_run_buf(pctx, "abc\naaa", 7, &out, &out_len) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_lib_run");
+        led_assert(out_len == 8 && memcmp(out, "bbc\nbbb\n", 8) == 0, LED_ERR_INTERNAL, "led_test_lib_run");
+    }
+    led_lib_free(pctx);
+
+    const char* bad_args[] = { "s/(/b/" };
+    led_assert(led_lib_compile(&pctx, 1, bad_args) == LED_ERR_PCRE, LED_ERR_INTERNAL, "led_test_lib_run");
+    led_debug("%s", led_lib_message(pctx));
+    led_lib_free(pctx);
+}
+
+void led_test_regex_intern() {
+    led_regex_t* regex1 = led_regex_compile("^a+");
+    led_regex_t* regex2 = led_regex_compile("^a+");
+    led_assert(regex1 == regex2 && regex1->refs == 2, LED_ERR_INTERNAL, "led_test_regex_intern");
+    led_u8s_decl_str(lstr, "aab");
+    led_assert(led_u8s_match(&lstr, regex1), LED_ERR_INTERNAL, "led_test_regex_intern");
+    size_t count = led_regex_alloc_count;
+    for (int i = 0; i < 100; i++)
+        led_u8s_match(&lstr, regex2);
+    led_assert(count == led_regex_alloc_count, LED_ERR_INTERNAL, "led_test_regex_intern");
+    led_regex_release(regex1);
+    led_regex_release(regex2);
+}
+
+void led_test_grep_literal() {
+    const char* cases[][2] = {
+        { "abc", "abc" },
+        { "ab?cd", "cd" },
+        { "abcé?", "abc" },
+        { "\\w{2}x{0,1}\\.", "." },
+        { "\\d+\\.\\d+ms", "ms" },
+        { "a{x}", "a" },
+        { "\\Q)\\E(abc)?x", ")" },
+        { "\\Qa.b\\E+c", "a.b" },
+        { "[\\Q]a\\E]zz", "zz" },
+        { "foo[Yy]bar", "foo" },
+        { "[Yy]", "" },
+        { "[^]a-c]de", "de" },
+        { "\\x{41}bcd\\p{L}ef", "bcd" },
+        { "\\x41bc", "bc" },
+        { "\\pLxy\\cXab", "xy" },
+        { "(?<n>ab)\\k<n>xyz", "xyz" },
+        { "(a)\\g{1}abc\\1xy", "abc" },
+    };
+    char lit[LED_GREP_LIT_MAX];
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        led_grep_literal(cases[i][0], lit, sizeof lit);
+        led_debug("%s -> %s", cases[i][0], lit);
+        led_assert(strcmp(lit, cases[i][1]) == 0, LED_ERR_INTERNAL, "led_test_grep_literal: %s", cases[i][0]);
+    }
+}
+
+void led_test_grep_lines() {
+    // the grep mode output is the one of the line by line path (forced by a function)
+    const char* patterns[] = { "[Yy]", "[Yy]z", "a?[Yy]", "\\w{2}x{0,1}\\.", "\\Q)\\E(abc)?x", "b\\.c?$", "^$" };
+    const char* in = "y\nyz\nab.\nY)x\n\nxab.c\nb.\nAy\n";
+    for (size_t i = 0; i < sizeof patterns / sizeof *patterns; i++) {
+        for (int invert = 0; invert < 2; invert++) {
+            led_t* pgrep;
+            led_t* pline;
+            const char* grep_args[] = { patterns[i], "-n" };
+            const char* line_args[] = { patterns[i], "r/", "-s", "-n" };
+            const char* grep_out;
+            const char* line_out;
+            size_t grep_len, line_len;
+            led_assert(led_lib_compile(&pgrep, 1 + invert, grep_args) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_grep_lines");
+            led_assert(led_lib_compile(&pline, 3 + invert, line_args) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_grep_lines");
+            led_assert(pgrep->grep.enabled && !pline->grep.enabled, LED_ERR_INTERNAL, "led_test_grep_lines");
+            led_lib_run_buf(pgrep, in, strlen(in), &grep_out, &grep_len);
+            led_lib_run_buf(pline, in, strlen(in), &line_out, &line_len);
+            led_assert(grep_len == line_len && memcmp(grep_out, line_out, grep_len) == 0, LED_ERR_INTERNAL, "led_test_grep_lines: %s", patterns[i]);
+            led_lib_free(pgrep);
+            led_lib_free(pline);
+        }
+    }
+}
+
+void led_test_utf8_check() {
+    // long enough buffers to cross the vector blocks
+    char buf[200];
+    memset(buf, 'a', sizeof buf);
+    led_assert(led_u8s_ascii_buf(buf, sizeof buf) == sizeof buf, LED_ERR_INTERNAL, "led_test_utf8_check");
+    memcpy(buf + 70, "日本", 6);
+    led_assert(led_u8s_ascii_buf(buf, sizeof buf) == 70, LED_ERR_INTERNAL, "led_test_utf8_check");
+    led_assert(led_u8s_valid_buf(buf, sizeof buf) == sizeof buf, LED_ERR_INTERNAL, "led_test_utf8_check");
+    // truncated sequence, overlong, surrogate and out of range
+    led_assert(led_u8s_valid_buf(buf, 75) == 73, LED_ERR_INTERNAL, "led_test_utf8_check");
+    const char* invalid[] = { "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\x80", "\xFF" };
+    for (size_t i = 0; i < sizeof invalid / sizeof *invalid; i++) {
+        memcpy(buf + 150, invalid[i], strlen(invalid[i]));
+        led_assert(led_u8s_valid_buf(buf, sizeof buf) == 150, LED_ERR_INTERNAL, "led_test_utf8_check");
+        memset(buf + 150, 'a', 4);
+    }
+}
+
+void led_test_case() {
+    led_u8s_decl(test, 128);
+    led_u8s_decl_str(src, "Élan ÄÖÜ straße ΣΑΣ ǅ and a longer ASCII RUN TO CROSS BLOCKS");
+    led_u8s_app_case_zn(&test, &src, 0, led_u8s_len(&src), false);
+    led_assert(led_u8s_equal_str(&test, "élan äöü straße σασ ǆ and a longer ascii run to cross blocks"), LED_ERR_INTERNAL, "led_test_case");
+    led_u8s_empty(&test);
+    led_u8s_app_case_zn(&test, &src, 0, led_u8s_len(&src), true);
+    led_assert(led_u8s_equal_str(&test, "ÉLAN ÄÖÜ STRAßE ΣΑΣ Ǆ AND A LONGER ASCII RUN TO CROSS BLOCKS"), LED_ERR_INTERNAL, "led_test_case");
+    u8c_t e_acute, kanji;
+    led_u8c_from_str("é", &e_acute);
+    led_u8c_from_str("日", &kanji);
+    led_assert(led_u8c_isalnum(e_acute) && led_u8c_isalnum(kanji) && !led_u8c_isalnum('-'), LED_ERR_INTERNAL, "led_test_case");
+}
+
+void led_test_translate() {
+    const char* cases[][3] = {
+        { "tr//a-z/A-Z", "hello, World", "HELLO, WORLD\n" },
+        { "tr//a-/x_", "a-b", "x_b\n" },
+        { "tr//\\-\\\\/_+", "a-b\\c", "a_b+c\n" },
+        { "tr//0-9//d", "a1b22c", "abc\n" },
+        { "tr// //s", "a   b  c", "a b c\n" },
+        { "tr//ab/xx/s", "aabbc", "xc\n" },
+        { "tr//a-c/x/ds", "aabxx", "x\n" },
+        { "tr//éaß/Éα→", "éta ßé", "Étα →É\n" },
+        { "tr//α-γ/a-c", "βαγδ", "bacδ\n" },
+    };
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        led_t* pctx;
+        const char* out;
+        size_t out_len;
+        led_assert(led_lib_compile(&pctx, 1, &cases[i][0]) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_translate: %s", cases[i][0]);
+        led_assert(led_lib_run_buf(pctx, cases[i][1], strlen(cases[i][1]), &out, &out_len) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_translate: %s", cases[i][0]);
+        led_debug("%s: %.*s", cases[i][0], (int)out_len, out);
+        led_assert(out_len == strlen(cases[i][2]) && memcmp(out, cases[i][2], out_len) == 0, LED_ERR_INTERNAL, "led_test_translate: %s", cases[i][0]);
+        led_lib_free(pctx);
+    }
+    // reversed range, missing target and bad option
+    const char* bad_args[] = { "tr//z-a/A", "tr//abc", "tr//a/b/x" };
+    for (size_t i = 0; i < sizeof bad_args / sizeof *bad_args; i++) {
+        led_t* pctx;
+        led_assert(led_lib_compile(&pctx, 1, &bad_args[i]) == LED_ERR_ARG, LED_ERR_INTERNAL, "led_test_translate: %s", bad_args[i]);
+        led_lib_free(pctx);
+    }
+}
+
+void led_test_charset() {
+    // single byte and multibyte separators
+    led_charset_t set;
+    led_u8s_decl_str(chars, ",→;");
+    led_charset_init(&set, &chars);
+    led_u8s_decl_str(test, "a→→b,;c日d→");
+    size_t len = led_u8s_len(&test);
+    led_assert(led_charset_find(&set, &test, 0, len) == 1, LED_ERR_INTERNAL, "led_test_charset");
+    led_assert(led_charset_skip(&set, &test, 1, len) == 7, LED_ERR_INTERNAL, "led_test_charset");
+    led_assert(led_charset_find(&set, &test, 7, len) == 8, LED_ERR_INTERNAL, "led_test_charset");
+    led_assert(led_charset_skip(&set, &test, 8, len) == 10, LED_ERR_INTERNAL, "led_test_charset");
+    led_assert(led_charset_find(&set, &test, 10, len) == 15, LED_ERR_INTERNAL, "led_test_charset");
+    led_assert(led_charset_skip(&set, &test, 15, len) == len, LED_ERR_INTERNAL, "led_test_charset");
+    // the bytes of a multibyte separator are not separators
+    led_assert(led_charset_find(&set, &test, 11, 14) == 14, LED_ERR_INTERNAL, "led_test_charset");
+    led_charset_free(&set);
+}
+
+void led_test_field_list() {
+    const struct { const char* list; size_t from; size_t last; uint64_t field; } cases[] = {
+        { "3", 0, 3, 1 << 3 },
+        { "2-4", 0, 4, 1 << 2 | 1 << 3 | 1 << 4 },
+        { "-2", 0, 2, 1 << 1 | 1 << 2 },
+        { "5-", 5, SIZE_MAX, 1 << 5 | 1 << 6 },
+        { "1,3-4,6-", 6, SIZE_MAX, 1 << 1 | 1 << 3 | 1 << 4 | 1 << 6 },
+    };
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        led_fn_t func;
+        memset(&func, 0, sizeof func);
+        led_u8s_init_str(&func.arg[0].lstr, cases[i].list);
+        led_fn_init_field_list(&func, 0);
+        led_assert(func.cut.from == cases[i].from && func.cut.last == cases[i].last && (func.cut.field[0] & 0x7F) == cases[i].field,
+            LED_ERR_INTERNAL, "led_test_field_list: %s", cases[i].list);
+    }
+    const char* bad_lists[] = { "cut//0", "cut//3-2", "cut//a", "cut//1,,2" };
+    for (size_t i = 0; i < sizeof bad_lists / sizeof *bad_lists; i++) {
+        led_t* pctx;
+        led_assert(led_lib_compile(&pctx, 1, &bad_lists[i]) == LED_ERR_ARG, LED_ERR_INTERNAL, "led_test_field_list: %s", bad_lists[i]);
+        led_lib_free(pctx);
+    }
+    // a line without separator is kept whole, as with cut
+    led_t* pctx;
+    const char* args[] = { "cut//2,4/,;" };
+    const char* out;
+    size_t out_len;
+    led_assert(led_lib_compile(&pctx, 1, args) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_field_list");
+    led_assert(led_lib_run_buf(pctx, "a,b;;d\nabc", 10, &out, &out_len) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_field_list");
+    led_assert(out_len == 8 && memcmp(out, "b,d\nabc\n", 8) == 0, LED_ERR_INTERNAL, "led_test_field_list");
+    led_lib_free(pctx);
+}
+
+void led_test_base64() {
+    led_u8s_decl(test, 128);
+    led_u8s_decl(back, 128);
+    // long enough to cross the vector blocks, with a partial last group
+    led_u8s_decl_str(src, "base64 codec test string long enough for blocks?>");
+    led_u8s_app_b64_encode_zn(&test, &src, 0, led_u8s_len(&src), 0);
+    led_assert(led_u8s_equal_str(&test, "YmFzZTY0IGNvZGVjIHRlc3Qgc3RyaW5nIGxvbmcgZW5vdWdoIGZvciBibG9ja3M/Pg=="), LED_ERR_INTERNAL, "led_test_base64");
+    led_u8s_app_b64_decode_zn(&back, &test, 0, led_u8s_len(&test));
+    led_assert(led_u8s_equal_str(&back, led_u8s_str(&src)), LED_ERR_INTERNAL, "led_test_base64");
+    led_u8s_empty(&test);
+    led_u8s_app_b64_encode_zn(&test, &src, 0, led_u8s_len(&src), LED_B64_URL | LED_B64_NOPAD);
+    led_assert(led_u8s_equal_str(&test, "YmFzZTY0IGNvZGVjIHRlc3Qgc3RyaW5nIGxvbmcgZW5vdWdoIGZvciBibG9ja3M_Pg"), LED_ERR_INTERNAL, "led_test_base64");
+    led_u8s_empty(&back);
+    led_u8s_app_b64_decode_zn(&back, &test, 0, led_u8s_len(&test));
+    led_assert(led_u8s_equal_str(&back, led_u8s_str(&src)), LED_ERR_INTERNAL, "led_test_base64");
+    // the null bytes of a binary payload are kept through the functions
+    led_t* pctx;
+    const char* args[] = { "b64e/", "b64d/" };
+    const char* out;
+    size_t out_len;
+    led_assert(led_lib_compile(&pctx, 2, args) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_base64");
+    led_assert(led_lib_run_buf(pctx, "a\0b\0\0c", 6, &out, &out_len) == LED_SUCCESS, LED_ERR_INTERNAL, "led_test_base64");
+    led_assert(out_len == 7 && memcmp(out, "a\0b\0\0c\n", 7) == 0, LED_ERR_INTERNAL, "led_test_base64");
+    led_lib_free(pctx);
+}
+
+void led_test_escape() {
+    led_esc_t esc;
+    memset(&esc, 0, sizeof esc);
+    esc.byte['"'] = LED_ESC_BSL;
+    esc.byte['\n'] = 'n';
+    esc.byte[1] = LED_ESC_OCT;
+    led_esc_init(&esc);
+    led_u8s_decl(test, 128);
+    led_u8s_decl(back, 128);
+    // long enough to cross the vector blocks
+    led_u8s_decl_str(src, "a run long enough for the vector blocks \"q\"\n\x01 éléphant");
+    led_u8s_app_esc_zn(&test, &src, 0, led_u8s_len(&src), &esc);
+    led_assert(led_u8s_equal_str(&test, "a run long enough for the vector blocks \\\"q\\\"\\n\\001 éléphant"), LED_ERR_INTERNAL, "led_test_escape");
+    led_u8s_app_unesc_zn(&back, &test, 0, led_u8s_len(&test), LED_UNESC_C);
+    led_assert(led_u8s_equal_str(&back, led_u8s_str(&src)), LED_ERR_INTERNAL, "led_test_escape");
+    led_u8s_decl_str(json, "\\u00e9\\ud83d\\ude00\\x");
+    led_u8s_empty(&back);
+    led_u8s_app_unesc_zn(&back, &json, 0, led_u8s_len(&json), LED_UNESC_JSON);
+    led_assert(led_u8s_equal_str(&back, "é😀\\x"), LED_ERR_INTERNAL, "led_test_escape");
+}
+
+void led_test_hash() {
+    // generated input over 1 KiB for the multi-block paths
+    char buf[1500];
+    for (size_t i = 0; i < sizeof buf; i++) buf[i] = i % 251;
+    // one vector per XXH3 length class and SHA-256 padding with one, two and many blocks
+    const struct { size_t algo; const char* src; size_t len; const char* digest; } cases[] = {
+        { LED_HASH_CRC32C, "123456789", 9, "\xe3\x06\x92\x83" },
+        { LED_HASH_CRC32C, buf, 1500, "\x17\x09\x12\x6a" },
+        { LED_HASH_XXH3, buf, 0, "\x2d\x06\x80\x05\x38\xd3\x94\xc2" },
+        { LED_HASH_XXH3, buf, 3, "\x5f\x42\x99\xfc\x16\x1c\x9c\xbb" },
+        { LED_HASH_XXH3, buf, 8, "\x3a\x1c\x2d\x7c\x85\xaf\x88\xf8" },
+        { LED_HASH_XXH3, buf, 16, "\x83\x55\xe3\xa6\xf6\x17\x70\xdb" },
+        { LED_HASH_XXH3, buf, 128, "\x85\xc6\x17\x4c\x7f\xf4\xc4\x6b" },
+        { LED_HASH_XXH3, buf, 240, "\x37\x5a\x38\x4d\x95\x7f\xe8\x65" },
+        { LED_HASH_XXH3, buf, 1500, "\x69\x6f\x4e\x65\x2d\xa3\xac\xf2" },
+        { LED_HASH_SHA256, "abc", 3,
+            "\xba\x78\x16\xbf\x8f\x01\xcf\xea\x41\x41\x40\xde\x5d\xae\x22\x23\xb0\x03\x61\xa3\x96\x17\x7a\x9c\xb4\x10\xff\x61\xf2\x00\x15\xad" },
+        { LED_HASH_SHA256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 56,
+            "\x24\x8d\x6a\x61\xd2\x06\x38\xb8\xe5\xc0\x26\x93\x0c\x3e\x60\x39\xa3\x3c\xe4\x59\x64\xff\x21\x67\xf6\xec\xed\xd4\x19\xdb\x06\xc1" },
+        { LED_HASH_SHA256, buf, 1500,
+            "\x10\xd0\x9b\x10\x01\x88\x05\xbf\xa6\x90\xe6\xf7\x54\x6f\x48\x58\x25\x40\x5b\xb1\xaf\x39\xba\xb7\x5d\x2b\x63\x6b\x6e\xac\x58\xdb" },
+    };
+    const size_t sizes[] = { [LED_HASH_CRC32C] = 4, [LED_HASH_XXH3] = 8, [LED_HASH_SHA256] = 32 };
+    uint8_t digest[LED_HASH_SIZE_MAX];
+    for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+        size_t len = led_hash_digest(cases[i].algo, cases[i].src, cases[i].len, digest);
+        led_assert(len == sizes[cases[i].algo] && memcmp(digest, cases[i].digest, len) == 0, LED_ERR_INTERNAL, "led_test_hash: case %lu", i);
+    }
+}
+
 //-----------------------------------------------
 // LEDTEST main
 //-----------------------------------------------
@@ -72,5 +348,17 @@ int main(int , char* []) {
     test(led_test_char_last);
     test(led_test_trunk_char);
     test(led_test_cut_next);
+    test(led_test_lib_run);
+    test(led_test_regex_intern);
+    test(led_test_grep_literal);
+    test(led_test_grep_lines);
+    test(led_test_utf8_check);
+    test(led_test_case);
+    test(led_test_translate);
+    test(led_test_charset);
+    test(led_test_field_list);
+    test(led_test_base64);
+    test(led_test_escape);
+    test(led_test_hash);
     return 0;
 }
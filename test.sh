@@ -61,6 +61,22 @@ EXISTING LINE 1
 EXISTING LINE 2
 EOT
 
+mkdir -p $TEST_DIR/files_bad
+printf 'abc\n' > $TEST_DIR/files_bad/file_1
+printf 'ab\xff\ncd\n' > $TEST_DIR/files_bad/file_2
+printf 'def\n' > $TEST_DIR/files_bad/file_3
+
+mkdir -p $TEST_DIR/files_empty
+touch $TEST_DIR/files_empty/file_0
+printf 'TEST\n' > $TEST_DIR/files_empty/file_1
+
+mkdir -p $TEST_DIR/files_inplace
+printf 'AAA\nBBB\n' > $TEST_DIR/files_inplace/file_0
+printf 'AAA\nTEST\n' > $TEST_DIR/files_inplace/file_1
+
+mkdir -p $TEST_DIR/files_many
+for i in $(seq -w 1 40); do seq $i 3 900 > $TEST_DIR/files_many/file_$i; done
+
 mkdir -p $TEST_DIR/files_to_mv
 touch $TEST_DIR/files_to_mv/file1\ to\'\ mv.txt
 touch $TEST_DIR/files_to_mv/file2\ to\'\ mv.txt
@@ -127,6 +143,142 @@ if [[ $TEST == 13 || $TEST == all ]]; then
     ls $TEST_DIR/files_to_mv/* | led -v she// r// shu// fnc// 's//mv $R $0/' -X
 fi
 
+if [[ $TEST == 14 || $TEST == all ]]; then
+    echo -e "\ntest 14:"
+    # the invalid UTF-8 file is skipped, the next ones are processed
+    ls $TEST_DIR/files_bad/* | led cu/ -E.up -f
+    echo "exit code: $?"
+    cat $TEST_DIR/files_bad/*.up
+fi
+
+if [[ $TEST == 15 || $TEST == all ]]; then
+    echo -e "\ntest 15:"
+    # binary payload with null bytes through base64 and back
+    printf 'a\0b\n\0c\0' > $TEST_DIR/files_out/binary
+    led -p 'b64e/(?s).+' < $TEST_DIR/files_out/binary | led b64d/ | head -c 7 | cmp - $TEST_DIR/files_out/binary && echo "b64 round trip: ok"
+fi
+
+if [[ $TEST == 16 || $TEST == all ]]; then
+    echo -e "\ntest 16:"
+    # the empty file is unchanged, it is neither rewritten nor listed
+    stat_empty=$(stat -c '%i %Y' $TEST_DIR/files_empty/file_0)
+    ls $TEST_DIR/files_empty/* | led -v TEST -F -U -f
+    [[ $(stat -c '%i %Y' $TEST_DIR/files_empty/file_0) == $stat_empty ]] && echo "empty file unchanged: ok"
+fi
+
+if [[ $TEST == 17 || $TEST == all ]]; then
+    echo -e "\ntest 17:"
+    # the worker pool gives the serial output, the filenames in input order or in completion order with c
+    ls $TEST_DIR/files_many/file_?? | led '7$' 's/(\d+)/<$1>/' -E.serial -f > $TEST_DIR/files_out/list_serial
+    ls $TEST_DIR/files_many/file_?? | led -j4 '7$' 's/(\d+)/<$1>/' -E.pool -f > $TEST_DIR/files_out/list_pool
+    sed 's/\.pool$/.serial/' $TEST_DIR/files_out/list_pool | cmp - $TEST_DIR/files_out/list_serial && echo "pool order: ok"
+    for f in $TEST_DIR/files_many/file_??; do cmp -s $f.serial $f.pool || echo "pool output differs: $f"; done
+    ls $TEST_DIR/files_many/file_?? | led -j4c '7$' 's/(\d+)/<$1>/' -E.pool -f | sed 's/\.pool$/.serial/' | sort | cmp - $TEST_DIR/files_out/list_serial && echo "pool completion order: ok"
+    ls $TEST_DIR/files_many/file_?? | led -j4 '7$' -f | cmp - <(ls $TEST_DIR/files_many/file_?? | led '7$' -f) && echo "pool stdout: ok"
+fi
+
+if [[ $TEST == 18 || $TEST == all ]]; then
+    echo -e "\ntest 18:"
+    # a stream of several chunks processed in parallel gives the serial output
+    seq 1 2000000 > $TEST_DIR/files_out/stream
+    led '7$' 's/(\d+)/<$1>/' < $TEST_DIR/files_out/stream > $TEST_DIR/files_out/stream_serial
+    cat $TEST_DIR/files_out/stream | led -j4 '7$' 's/(\d+)/<$1>/' | cmp - $TEST_DIR/files_out/stream_serial && echo "chunks: ok"
+    cat $TEST_DIR/files_out/stream | led -j4c '7$' 's/(\d+)/<$1>/' | cmp - $TEST_DIR/files_out/stream_serial && echo "chunks with c: ok"
+fi
+
+if [[ $TEST == 19 || $TEST == all ]]; then
+    echo -e "\ntest 19:"
+    # substitute templates with registers, captures and literal segments
+    printf 'key=val\nab=cd\n' | led 'r/(\w+)=(\w+)/' 's/.+/$R2:$R1 [$R] $0 $R9./' | cmp - <(printf 'val:key [key=val] key=val .\ncd:ab [ab=cd] ab=cd .\n') && echo "templates: ok"
+    printf 'x=1 y=2\n' | led 'r/=(\d)/1' 's/(\w)=(\d)/$2.$R1.$1/g' | cmp - <(printf '1.1.x 2.1.y\n') && echo "global template: ok"
+fi
+
+if [[ $TEST == 20 || $TEST == all ]]; then
+    echo -e "\ntest 20:"
+    # the unchanged file keeps its inode and time, only the changed file is listed with -U
+    stat_0=$(stat -c '%i %y' $TEST_DIR/files_inplace/file_0)
+    stat_1=$(stat -c '%i %y' $TEST_DIR/files_inplace/file_1)
+    ls $TEST_DIR/files_inplace/* | led TEST 's/TEST/DONE/' -F -U -f | cmp - <(echo $TEST_DIR/files_inplace/file_1) && echo "changed file listed: ok"
+    [[ $(stat -c '%i %y' $TEST_DIR/files_inplace/file_0) == $stat_0 ]] && echo "unchanged file kept: ok"
+    [[ $(stat -c '%i %y' $TEST_DIR/files_inplace/file_1) != $stat_1 ]] && cat $TEST_DIR/files_inplace/file_1
+fi
+
+if [[ $TEST == 21 || $TEST == all ]]; then
+    echo -e "\ntest 21:"
+    # the command outputs keep the line order on one or several slots, a failing command gives exit code 6
+    seq 1 50 > $TEST_DIR/files_out/exec
+    for opt in -X -Xs "-j4 -X" "-j4 -Xs"; do
+        led 's/(.+)/echo $1/' $opt < $TEST_DIR/files_out/exec | cmp - $TEST_DIR/files_out/exec && echo "exec $opt order: ok"
+    done
+    printf 'true\nfalse\ntrue\n' | led -j4 -X
+    echo "exit code: $?"
+    printf 'true\nfalse\ntrue\n' | led -Xs
+    echo "exit code: $?"
+fi
+
+if [[ $TEST == 22 || $TEST == all ]]; then
+    echo -e "\ntest 22:"
+    # the batches keep the line order on one or several slots, a failing batch gives exit code 6
+    seq 1 50 > $TEST_DIR/files_out/batch
+    led -Xb7:echo < $TEST_DIR/files_out/batch | cmp - <(xargs -n7 echo < $TEST_DIR/files_out/batch) && echo "batch order: ok"
+    led -j4 -Xb7:echo < $TEST_DIR/files_out/batch | cmp - <(xargs -n7 echo < $TEST_DIR/files_out/batch) && echo "batch slots order: ok"
+    led -Xb:echo < $TEST_DIR/files_out/batch | tr ' ' '\n' | cmp - $TEST_DIR/files_out/batch && echo "batch system limit: ok"
+    printf '1\n2\n' | led -Xb:false
+    echo "exit code: $?"
+fi
+
+if [[ $TEST == 23 || $TEST == all ]]; then
+    echo -e "\ntest 23:"
+    # the JSON report is a valid JSON object with the list of stages
+    json_check='import json, sys; r = json.load(sys.stdin); assert isinstance(r["stages"], list)'
+    seq 1 50 > $TEST_DIR/files_out/report
+    led -rjson '7$' 's/(\d+)/<$1>/' < $TEST_DIR/files_out/report 2>&1 >/dev/null | python3 -c "$json_check" && echo "json report: ok"
+    ls $TEST_DIR/files_many/file_?? | led -rjson -j4 '7$' -E.pool -f 2>&1 >/dev/null | python3 -c "$json_check" && echo "json report pool: ok"
+    led -rjson 's/(.+)/echo $1/' -X < $TEST_DIR/files_out/report 2>&1 >/dev/null | python3 -c "$json_check" && echo "json report exec: ok"
+fi
+
+if [[ $TEST == 24 || $TEST == all ]]; then
+    echo -e "\ntest 24:"
+    # an output of many blocks is written whole and in order, to STDOUT and to a file
+    seq 1 300000 > $TEST_DIR/files_out/writer
+    sed 's/^/line /' $TEST_DIR/files_out/writer > $TEST_DIR/files_out/writer_ref
+    led 's/^/line /' < $TEST_DIR/files_out/writer | cmp - $TEST_DIR/files_out/writer_ref && echo "writer stdout: ok"
+    echo $TEST_DIR/files_out/writer | led 's/^/line /' -E.blocks -f > /dev/null
+    cmp $TEST_DIR/files_out/writer.blocks $TEST_DIR/files_out/writer_ref && echo "writer file: ok"
+fi
+
+if [[ $TEST == 25 || $TEST == all ]]; then
+    echo -e "\ntest 25:"
+    # the same input read from a pipe, a small file and a mapped file over 1 MiB
+    seq 1 200000 | sed 's/$/ éà/' > $TEST_DIR/files_out/reader
+    printf 'no newline at end' >> $TEST_DIR/files_out/reader
+    head -n 100 $TEST_DIR/files_out/reader > $TEST_DIR/files_out/reader_small
+    led '3 ' 's/é/e/' < $TEST_DIR/files_out/reader > $TEST_DIR/files_out/reader_mmap
+    cat $TEST_DIR/files_out/reader | led '3 ' 's/é/e/' | cmp - $TEST_DIR/files_out/reader_mmap && echo "reader pipe: ok"
+    { sed '/3 /s/é/e/' $TEST_DIR/files_out/reader; echo; } | cmp - $TEST_DIR/files_out/reader_mmap && echo "reader mmap: ok"
+    led '3 ' 's/é/e/' < $TEST_DIR/files_out/reader_small | cmp - <(cat $TEST_DIR/files_out/reader_small | led '3 ' 's/é/e/') && echo "reader small file: ok"
+fi
+
+if [[ $TEST == 26 || $TEST == all ]]; then
+    echo -e "\ntest 26:"
+    # lines over the former 32K limit and over the read block, and the -L limit exit code
+    { echo short; head -c 40000 /dev/zero | tr '\0' a; echo; head -c 600000 /dev/zero | tr '\0' b; echo; echo end; } > $TEST_DIR/files_out/long
+    sed 's/\(.\)$/\1Z/' $TEST_DIR/files_out/long > $TEST_DIR/files_out/long_ref
+    led 's/(.)$/$1Z/' < $TEST_DIR/files_out/long | cmp - $TEST_DIR/files_out/long_ref && echo "long lines file: ok"
+    cat $TEST_DIR/files_out/long | led 's/(.)$/$1Z/' | cmp - $TEST_DIR/files_out/long_ref && echo "long lines pipe: ok"
+    cat $TEST_DIR/files_out/long | led -L100K 's/(.)$/$1Z/' > /dev/null
+    echo "exit code: $?"
+fi
+
+if [[ $TEST == 27 || $TEST == all ]]; then
+    echo -e "\ntest 27:"
+    # chained functions on lines of alternating sizes leave nothing from the previous lines
+    awk 'BEGIN { for (i = 1; i <= 2000; i++) { s = ""; for (j = i * 37 % 700; j > 0; j--) s = s "ab"; print s "c" i } }' > $TEST_DIR/files_out/recycle
+    sed 's/b/x/g' $TEST_DIR/files_out/recycle | tr 'a-z' 'A-Z' | tr 'A' 'y' > $TEST_DIR/files_out/recycle_ref
+    led 's/b/x/g' cu/ 'tr//A/y' < $TEST_DIR/files_out/recycle | cmp - $TEST_DIR/files_out/recycle_ref && echo "chained functions: ok"
+    led -p '[0-4]$' 's/b/x/g' < $TEST_DIR/files_out/recycle | cmp - <(sed '/[0-4]$/s/b/x/g' $TEST_DIR/files_out/recycle) && echo "packed lines: ok"
+fi
+
 echo -e "\nfiles:"
 ls -1 $TEST_DIR/files_in/*
 ls -1 $TEST_DIR/files_out/*